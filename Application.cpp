@@ -5,6 +5,7 @@
 #include "classes/Othello.h"
 #include "classes/Connect4.h"
 #include "classes/Chess.h"
+#include "classes/Trace.h"
 
 namespace ClassGame {
         //
@@ -29,6 +30,7 @@ namespace ClassGame {
         //
         void RenderGame() 
         {
+                TRACE_SCOPE("RenderGame");
                 ImGui::DockSpaceOverViewport();
 
                 //ImGui::ShowDemoWindow();
@@ -76,6 +78,7 @@ namespace ClassGame {
                         ImGui::Text("%s", stateString.substr(y*stride,stride).c_str());
                     }
                     ImGui::Text("Current Board State: %s", game->stateString().c_str());
+                    game->drawSettings();
                 }
                 ImGui::End();
 
@@ -1,6 +1,10 @@
 #include "Chess.h"
 #include "Bitboard.h"
 #include "GameState.h"
+#include "Search.h"
+#include "Trace.h"
+#include "../imgui/imgui.h"
+#include <cfloat>
 #include <limits>
 #include <cmath>
 #include <iostream>
@@ -11,12 +15,7 @@
 #include <cctype>
 #include <map>
 #include <algorithm>
-
-static constexpr int NEG_INF = -1000000000;
-static constexpr int POS_INF =  1000000000;
-static constexpr int MATE_SCORE = 10'000'000;
-
-static long long g_countNodes = 0;
+#include <thread>
 
 static bool g_masksInit = false;
 
@@ -36,9 +35,10 @@ static int findKingSquare(const char state[64], char kingChar) {
     return -1;
 }
 
-static void buildGameStateFromBoard(Chess* self, GameState& gs, char color)
+// the board string can't tell a king or rook that went out and came back, so init()'s
+// home square guess is narrowed to the rights the game has kept
+static void buildGameStateFromBoard(const std::string& ui, unsigned char castling, GameState& gs, char color)
 {
-    std::string ui = self->stateString();
     char engineState[64];
 
     for (int uiIdx = 0; uiIdx < 64; ++uiIdx) {
@@ -50,16 +50,62 @@ static void buildGameStateFromBoard(Chess* self, GameState& gs, char color)
     }
 
     gs.init(engineState, color);
+    gs.castling &= castling;
+    gs.hash = gs.computeHash();
 }
 
 
-Chess::Chess()
+// one core is left for the render loop while the AI thinks
+Chess::Chess() : _search(_transpositionTable, std::max(1, (int)std::thread::hardware_concurrency() - 1))
 {
     _grid = new Grid(8, 8);
+    // a second a move keeps the game moving on any machine
+    _searchLimits.moveTimeMs = 1000;
+    // optional, nothing is shipped in resources by default
+    loadNetwork("resources/chess.nnue");
+    loadTablebases("resources/tablebases");
+    loadOpeningBook("resources/book.bin");
+}
+
+bool Chess::loadOpeningBook(const std::string& path)
+{
+    _bookRandom.seed(std::random_device()());
+    return _openingBook.open(path);
+}
+
+void Chess::setTranspositionTableSize(size_t sizeMB)
+{
+    // the search threads probe the table, it can't be reallocated under them
+    cancelSearch();
+    _transpositionTable.resize(sizeMB);
+}
+
+void Chess::setSearchThreads(int threads)
+{
+    cancelSearch();
+    _search.setThreadCount(threads);
+}
+
+int Chess::loadTablebases(const std::string& directory)
+{
+    cancelSearch();
+    int loaded = _tablebases.loadDirectory(directory);
+    _search.setTablebases(_tablebases.maxPieces() ? &_tablebases : nullptr);
+    return loaded;
+}
+
+bool Chess::loadNetwork(const std::string& path)
+{
+    // the search threads read the weights, they can't be unmapped under them
+    cancelSearch();
+    bool loaded = _network.load(path);
+    _search.setNetwork(loaded ? &_network : nullptr);
+    return loaded;
 }
 
 Chess::~Chess()
 {
+    cancelSearch();
     delete _grid;
 }
 
@@ -99,9 +145,14 @@ Bit* Chess::PieceForPlayer(const int playerNumber, ChessPiece piece)
 
 void Chess::setUpBoard()
 {
+    cancelSearch();
+    _transpositionTable.clear();
+    _searchHistory.clear();
+    _castling = AllCastling;
     setNumberOfPlayers(2);
     setAIPlayer(1);
-    _gameOptions.AIMAXDepth = 3;
+    // no depth cap, the AI deepens until its time is up
+    _gameOptions.AIMAXDepth = 0;
     _gameOptions.rowX = 8;
     _gameOptions.rowY = 8;
 
@@ -205,21 +256,10 @@ bool Chess::canBitMoveFromTo(Bit& bit, BitHolder& src, BitHolder& dst)
     int fromEngine = s->getRow() * 8 + s->getColumn();
     int toEngine   = d->getRow() * 8 + d->getColumn();
 
-    std::string ui = stateString();
-    char engineState[64];
-
-    for (int uiIdx = 0; uiIdx < 64; ++uiIdx) {
-        int file = uiIdx % 8;
-        int rankFromTop = uiIdx / 8;
-        int y = 7 - rankFromTop;
-        int engineIdx = y * 8 + file;
-        engineState[engineIdx] = ui[uiIdx];
-    }
-
     int color = (getCurrentPlayer()->playerNumber() == 0) ? WHITE : BLACK;
 
     GameState gs;
-    gs.init(engineState, (char)color);
+    buildGameStateFromBoard(stateString(), _castling, gs, (char)color);
 
     auto moves = gs.generateAllMoves();
 
@@ -231,8 +271,44 @@ bool Chess::canBitMoveFromTo(Bit& bit, BitHolder& src, BitHolder& dst)
     return false;
 }
 
+void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
+{
+    // a drag only moves the one piece, finish castling and promotion on the board string
+    auto* s = static_cast<ChessSquare*>(&src);
+    auto* d = static_cast<ChessSquare*>(&dst);
+
+    int ptype = pieceTypeFromTag(bit.gameTag());
+    bool isBlack = ownerFromTag(bit.gameTag()) == 1;
+    int rankFromTop = 7 - d->getRow();
+    int fileDelta = d->getColumn() - s->getColumn();
+
+    // a king or rook leaving its home square, or a rook taken on it, loses that right
+    _castling &= GameState::castlingMask(s->getRow() * 8 + s->getColumn()) &
+                 GameState::castlingMask(d->getRow() * 8 + d->getColumn());
+
+    std::string ui = stateString();
+    bool changed = false;
+
+    if (ptype == King && (fileDelta == 2 || fileDelta == -2)) {
+        int rookFrom = rankFromTop * 8 + (fileDelta > 0 ? 7 : 0);
+        int rookTo = rankFromTop * 8 + (fileDelta > 0 ? 5 : 3);
+        ui[rookTo] = ui[rookFrom];
+        ui[rookFrom] = '0';
+        changed = true;
+    } else if (ptype == Pawn && (d->getRow() == 7 || d->getRow() == 0)) {
+        ui[rankFromTop * 8 + d->getColumn()] = isBlack ? 'q' : 'Q';
+        changed = true;
+    }
+
+    if (changed) {
+        setStateString(ui);
+    }
+    Game::bitMovedFromTo(bit, src, dst);
+}
+
 void Chess::stopGame()
 {
+    cancelSearch();
     _grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
     });
@@ -253,10 +329,11 @@ Player* Chess::ownerAt(int x, int y) const
 
 Player* Chess::checkForWinner()
 {
+    TRACE_SCOPE("checkForWinner");
     char color = (getCurrentPlayer()->playerNumber() == 0) ? WHITE : BLACK;
 
     GameState gs;
-    buildGameStateFromBoard(this, gs, color);
+    buildGameStateFromBoard(stateString(), _castling, gs, color);
 
     auto moves = gs.generateAllMoves();
     if (!moves.empty()) return nullptr;
@@ -270,10 +347,11 @@ Player* Chess::checkForWinner()
 
 bool Chess::checkForDraw()
 {
+    TRACE_SCOPE("checkForDraw");
     char color = (getCurrentPlayer()->playerNumber() == 0) ? WHITE : BLACK;
 
     GameState gs;
-    buildGameStateFromBoard(this, gs, color);
+    buildGameStateFromBoard(stateString(), _castling, gs, color);
 
     auto moves = gs.generateAllMoves();
     if (!moves.empty()) return false;
@@ -372,103 +450,90 @@ static inline void indexToXYGrid(int idx, int& x, int& y)
     y = 7 - rankFromTop;
 }
 
-static std::map<char, int> evaluateScores = {
-    {'P',  100}, {'p', -100}, // Pawns
-    {'N',  200}, {'n', -200}, // Knights
-    {'B',  230}, {'b', -230}, // Bishops
-    {'R',  400}, {'r', -400}, // Rooks
-    {'Q',  900}, {'q', -900}, // Queens
-    {'K', 2000}, {'k',-2000}, // Kings
-    {'0',    0}               // Empty square
-};
-
-static int evaluateBoard(const std::string& state)
+void Chess::updateAI()
 {
-    int value = 0;
-    for (char ch : state) {
-        value += evaluateScores[ch];
+    TRACE_SCOPE("updateAI");
+    if (_searchThread.joinable()) {
+        if (_searchDone.load(std::memory_order_acquire)) {
+            _searchThread.join();
+            applySearchResult();
+        }
+        return;
     }
-    return value;
-}
 
-static int evaluateBoard(const char st[64]) {
-    int s = 0;
-    for (int i = 0; i < 64; ++i) s += evaluateScores[st[i]];
-    return s;
+    Player* cur = getCurrentPlayer();
+    if (!cur || !cur->isAIPlayer()) return;
+
+    int color = (cur->playerNumber() == 0) ? WHITE : BLACK;
+    startSearch(color);
 }
 
-static int negamax(GameState& gs, int depth, int alpha, int beta)
+void Chess::startSearch(int color)
 {
-    auto moves = gs.generateAllMoves();
+    std::string ui = stateString();
 
-    if (moves.empty())
-    {
-        if (gs.inCheck(gs.color)) {
-            return -(MATE_SCORE + depth);
-        }
-        return 0;
+    if (!_searchPosition) {
+        _searchPosition = std::make_unique<GameState>();
     }
-
-    if (depth == 0) {
-        return evaluateBoard(gs.state) * gs.color;
+    buildGameStateFromBoard(ui, _castling, *_searchPosition, (char)color);
+    _searchStartState = ui;
+    _searchTurn = getCurrentTurnNo();
+
+    // in book the move is played straight away, no search thread is started
+    BitMove bookMove;
+    if (_openingBook.pickMove(*_searchPosition, _bookRandom(), bookMove)) {
+        _searchResult = SearchResult();
+        _searchResult.bestMove = bookMove;
+        _bookMove = true;
+        applySearchResult();
+        return;
     }
+    _bookMove = false;
 
-    int best = NEG_INF;
-
-    for (const auto& m : moves) {
-        gs.pushMove(m);
-        int val = -negamax(gs, depth - 1, -beta, -alpha);
-        gs.popState();
-
-        if (val > best) best = val;
-        if (best > alpha) alpha = best;
-        if (alpha >= beta) break;
+    SearchLimits limits = _searchLimits;
+    if (_gameOptions.AIMAXDepth > 0) {
+        limits.maxDepth = _gameOptions.AIMAXDepth;
     }
 
-    return best;
+    // the table is kept between moves, positions searched last turn are still useful
+    _transpositionTable.newSearch();
+    {
+        std::lock_guard<std::mutex> lock(_liveMutex);
+        _liveValid = false;
+    }
+    // once per iteration, the UI thread copies it out under the same lock
+    _search.setIterationCallback([this](const SearchResult& result) {
+        std::lock_guard<std::mutex> lock(_liveMutex);
+        _liveResult = result;
+        _liveValid = true;
+    });
+    _searchDone.store(false, std::memory_order_relaxed);
+    _searchThread = std::thread([this, limits]() {
+        TRACE_THREAD_NAME("search");
+        TRACE_SCOPE("think");
+        _searchResult = _search.think(*_searchPosition, limits);
+        _searchDone.store(true, std::memory_order_release);
+    });
 }
 
-void Chess::updateAI()
+void Chess::applySearchResult()
 {
-    Player* cur = getCurrentPlayer();
-    if (!cur || !cur->isAIPlayer()) return;
-
-    std::string ui = stateString();
-    char engineState[64];
-
-    for (int uiIdx = 0; uiIdx < 64; ++uiIdx) {
-        int file = uiIdx % 8;
-        int rankFromTop = uiIdx / 8;
-        int y = 7 - rankFromTop;
-        int engineIdx = y * 8 + file;
-        engineState[engineIdx] = ui[uiIdx];
-    }
+    // the board moved on while we were thinking, the move is for a position that's gone
+    if (getCurrentTurnNo() != _searchTurn || stateString() != _searchStartState) return;
 
-    int color = (cur->playerNumber() == 0) ? WHITE : BLACK;
-
-    GameState gs;
-    gs.init(engineState, (char)color);
-
-    int depth = (_gameOptions.AIMAXDepth > 0) ? _gameOptions.AIMAXDepth : 3;
+    BitMove bestMove = _searchResult.bestMove;
+    if (bestMove.piece == NoPiece) return;
 
-    auto rootMoves = gs.generateAllMoves();
-    if (rootMoves.empty()) return;
-
-    int bestVal = NEG_INF;
-    BitMove bestMove;
-
-    for (const auto& m : rootMoves) {
-        gs.pushMove(m);
-        int val = -negamax(gs, depth - 1, NEG_INF, POS_INF);
-        gs.popState();
-
-        if (val > bestVal) {
-            bestVal = val;
-            bestMove = m;
-        }
-    }
+    MoveStats stats;
+    stats.turn = _searchTurn;
+    stats.move = moveToString(bestMove);
+    stats.fromBook = _bookMove;
+    stats.search = _searchResult;
+    _searchHistory.push_back(stats);
 
+    GameState& gs = *_searchPosition;
     gs.pushMove(bestMove);
+    _castling = gs.castling;
 
     std::string newUi(64, '0');
     for (int engineIdx = 0; engineIdx < 64; ++engineIdx) {
@@ -482,3 +547,100 @@ void Chess::updateAI()
     setStateString(newUi);
     endTurn();
 }
+
+void Chess::cancelSearch()
+{
+    if (_searchThread.joinable()) {
+        // keep asking, a stop that lands before think() has started is reset by it
+        while (!_searchDone.load(std::memory_order_acquire)) {
+            _search.stop();
+            std::this_thread::yield();
+        }
+        _searchThread.join();
+    }
+    _searchDone.store(false, std::memory_order_relaxed);
+}
+
+static void drawSearchResult(const SearchResult& r)
+{
+    ImGui::Text("nodes: %llu  nps: %.0f", (unsigned long long)r.nodes, r.nodesPerSecond());
+    ImGui::Text("depth: %d  seldepth: %d  time: %.3fs", r.depth, r.selDepth, r.seconds);
+    ImGui::Text("tt hits: %.1f%%  cutoffs: %.1f%%  first move cutoffs: %.1f%%", r.ttHitRate() * 100.0,
+                r.betaCutoffRate() * 100.0, r.firstMoveCutoffRate() * 100.0);
+}
+
+void Chess::drawSettings()
+{
+    if (!ImGui::CollapsingHeader("Search", ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+    if (_searchThread.joinable()) {
+        // as of the last finished iteration, the main search thread's counts only
+        SearchResult live;
+        bool valid;
+        {
+            std::lock_guard<std::mutex> lock(_liveMutex);
+            live = _liveResult;
+            valid = _liveValid;
+        }
+        if (valid) {
+            ImGui::Text("thinking: best so far %s, score %d", moveToString(live.bestMove).c_str(), live.score);
+            drawSearchResult(live);
+        } else {
+            ImGui::Text("thinking...");
+        }
+        ImGui::Separator();
+    }
+    if (_searchHistory.empty()) {
+        ImGui::Text("no AI moves yet");
+        return;
+    }
+
+    const MoveStats& last = _searchHistory.back();
+    ImGui::Text("last move: %s%s", last.move.c_str(), last.fromBook ? " (book)" : "");
+    if (!last.fromBook) {
+        drawSearchResult(last.search);
+    }
+
+    // where the time went over the game
+    double totalSeconds = 0;
+    uint64_t totalNodes = 0;
+    std::vector<float> times;
+    for (const MoveStats& stats : _searchHistory) {
+        totalSeconds += stats.search.seconds;
+        totalNodes += stats.search.nodes;
+        times.push_back((float)stats.search.seconds);
+    }
+    ImGui::Text("game: %d moves, %.2fs, %llu nodes, %.0f nps", (int)_searchHistory.size(), totalSeconds,
+                (unsigned long long)totalNodes, totalSeconds > 0 ? totalNodes / totalSeconds : 0.0);
+    ImGui::PlotHistogram("time per move", times.data(), (int)times.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                  ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("search history", 9, flags, ImVec2(0, ImGui::GetTextLineHeightWithSpacing() * 12))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        for (const char* name : { "turn", "move", "depth", "sel", "nodes", "nps", "tt%", "cut%", "time" }) {
+            ImGui::TableSetupColumn(name);
+        }
+        ImGui::TableHeadersRow();
+        // newest at the top
+        for (auto it = _searchHistory.rbegin(); it != _searchHistory.rend(); ++it) {
+            const SearchResult& s = it->search;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%d", it->turn);
+            ImGui::TableNextColumn(); ImGui::Text("%s", it->move.c_str());
+            if (it->fromBook) {
+                ImGui::TableNextColumn(); ImGui::Text("book");
+                continue;
+            }
+            ImGui::TableNextColumn(); ImGui::Text("%d", s.depth);
+            ImGui::TableNextColumn(); ImGui::Text("%d", s.selDepth);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.nodes);
+            ImGui::TableNextColumn(); ImGui::Text("%.0f", s.nodesPerSecond());
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", s.ttHitRate() * 100.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", s.betaCutoffRate() * 100.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.seconds);
+        }
+        ImGui::EndTable();
+    }
+}
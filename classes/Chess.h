@@ -1,8 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
 #include "Game.h"
 #include "Grid.h"
 #include "Bitboard.h"
+#include "TranspositionTable.h"
+#include "SmpSearch.h"
+#include "OpeningBook.h"
 
 constexpr int pieceSize = 80;
 
@@ -17,6 +25,7 @@ public:
     bool canBitMoveFrom(Bit &bit, BitHolder &src) override;
     bool canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
     bool actionForEmptyHolder(BitHolder &holder) override;
+    void bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
 
     void stopGame() override;
 
@@ -30,12 +39,68 @@ public:
     Grid* getGrid() override { return _grid; }
 
     bool gameHasAI() override { return true; }
+    // never blocks: starts a search on a worker thread on the AI's turn, and on later
+    // frames plays its move once it has finished
     void updateAI() override;
+    // stops a running search and throws its result away
+    void cancelSearch();
+
+    // size of the transposition table shared by every search in this game
+    void setTranspositionTableSize(size_t sizeMB);
+    // how long the AI thinks, AIMAXDepth (when set) caps the depth on top of this
+    void setSearchLimits(const SearchLimits& limits) { _searchLimits = limits; }
+    const SearchLimits& searchLimits() const { return _searchLimits; }
+    // threads the AI searches with, they all share the transposition table
+    void setSearchThreads(int threads);
+    int searchThreads() const { return _search.threadCount(); }
+    // evaluate with an NNUE file, the piece-square tables are used when it can't be loaded
+    bool loadNetwork(const std::string& path);
+    bool usingNetwork() const { return _network.loaded(); }
+    // endgame tables (*.tb from tools/tbgen) the search probes, returns how many loaded
+    int loadTablebases(const std::string& directory);
+    // polyglot layout book (see tools/book_builder) the AI plays from before it searches
+    bool loadOpeningBook(const std::string& path);
+
+    // one entry per move the AI has played this game, oldest first
+    struct MoveStats
+    {
+        int turn = 0;
+        std::string move;
+        bool fromBook = false;
+        SearchResult search;    // empty for a book move
+    };
+    const std::vector<MoveStats>& searchHistory() const { return _searchHistory; }
+    // the last search and the per-move history, in the Settings window
+    void drawSettings() override;
 
 private:
     Bit* PieceForPlayer(const int playerNumber, ChessPiece piece);
     Player* ownerAt(int x, int y) const;
     void FENtoBoard(const std::string& fen);
     char pieceNotation(int x, int y) const;
+    void startSearch(int color);
+    void applySearchResult();
     Grid* _grid;
+    TranspositionTable _transpositionTable;
+    nnue::Network _network;
+    tb::Tablebases _tablebases;
+    book::OpeningBook _openingBook;
+    std::mt19937_64 _bookRandom;
+    SmpSearch _search;
+    SearchLimits _searchLimits;
+    std::vector<MoveStats> _searchHistory;
+    bool _bookMove = false;
+    unsigned char _castling = AllCastling;  // rights still held, cleared as kings and rooks move
+
+    // background search, only touched by the worker while _searchThread runs
+    std::thread _searchThread;
+    std::atomic<bool> _searchDone{false};
+    std::unique_ptr<GameState> _searchPosition;
+    SearchResult _searchResult;
+    std::string _searchStartState;      // board the search started from
+    unsigned int _searchTurn = 0;
+    // last finished iteration of the running search, for the Settings window
+    std::mutex _liveMutex;
+    SearchResult _liveResult;
+    bool _liveValid = false;
 };
\ No newline at end of file
@@ -55,6 +55,8 @@ public:
 	virtual void setUpBoard() = 0;
 
 	virtual void drawFrame();
+	// extra rows a game adds to the Settings window, under the board state
+	virtual void drawSettings() {}
 
 	// end the current game turn
 	virtual void endTurn();
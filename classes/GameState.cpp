@@ -1,74 +1,251 @@
 
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 #include "GameState.h"
 #include "MagicBitboards.h"
 
-static int _bitboardLookup[128];
 static bool _initedMagic = false;
 static BitBoard _pawnAttacks[2][64]; // Precomputed pawn attacks for each square
+static uint64_t _squaresBetween[64][64]; // squares strictly between two aligned squares
+static uint64_t _lineBetween[64][64];    // the whole line through two aligned squares
 
 void GameState::init(const char* newState, char player) {
     std::memcpy(state, newState, 64);
     color = player;
     flags = 0;
-    _zobristHash[0] = 0;
-    _zobristHash[1] = 0;
     _attackBitBoard.setData(0);
-    // Clear all bitboards
-    for (int i = 0; i < e_numBitboards; ++i) {
-        _bitboards[i].setData(0);
-    }
+    stackPtr = 0;
 
     if (!_initedMagic) {
         initMagicBitboards();
-        // remove branching when we make the bitboards
-        for(int i=0; i<128; i++) { _bitboardLookup[i] = 0; }
-
-        _bitboardLookup['P'] = WHITE_PAWNS;
-        _bitboardLookup['N'] = WHITE_KNIGHTS;
-        _bitboardLookup['B'] = WHITE_BISHOPS;
-        _bitboardLookup['R'] = WHITE_ROOKS;
-        _bitboardLookup['Q'] = WHITE_QUEENS;
-        _bitboardLookup['K'] = WHITE_KING;
-        _bitboardLookup['p'] = BLACK_PAWNS;
-        _bitboardLookup['n'] = BLACK_KNIGHTS;
-        _bitboardLookup['b'] = BLACK_BISHOPS;
-        _bitboardLookup['r'] = BLACK_ROOKS;
-        _bitboardLookup['q'] = BLACK_QUEENS;
-        _bitboardLookup['k'] = BLACK_KING;
-        _bitboardLookup['0'] = EMPTY_SQUARES;
 
         for(int square = 0; square < 64; square++) {
             _pawnAttacks[0][square].setData(generatePawnAttacksBitBoard(square, WHITE));
             _pawnAttacks[1][square].setData(generatePawnAttacksBitBoard(square, BLACK));
         }
 
+        for (int from = 0; from < 64; from++) {
+            for (int to = 0; to < 64; to++) {
+                _squaresBetween[from][to] = 0;
+                _lineBetween[from][to] = 0;
+                const uint64_t toMask = 1ULL << to;
+                if (from == to) continue;
+                if (getRookAttacks(from, 0) & toMask) {
+                    _squaresBetween[from][to] = getRookAttacks(from, toMask) & getRookAttacks(to, 1ULL << from);
+                    _lineBetween[from][to] = (getRookAttacks(from, 0) & getRookAttacks(to, 0)) | (1ULL << from) | toMask;
+                } else if (getBishopAttacks(from, 0) & toMask) {
+                    _squaresBetween[from][to] = getBishopAttacks(from, toMask) & getBishopAttacks(to, 1ULL << from);
+                    _lineBetween[from][to] = (getBishopAttacks(from, 0) & getBishopAttacks(to, 0)) | (1ULL << from) | toMask;
+                }
+            }
+        }
+
         _initedMagic = true;
 
-        std::cout << "initialized magic bitboards and bitboard lookup" << std::endl;
+        std::cerr << "initialized magic bitboards (" << sliderBackendName(activeSliderBackend()) << ")" << std::endl;
+    }
+
+    rebuildBitboards();
+
+    // the board string carries no castling or en passant info, so assume a right is
+    // still there as long as its king and rook are on their home squares
+    castling = 0;
+    if (state[4] == 'K' && state[7] == 'R')   castling |= WhiteKingSide;
+    if (state[4] == 'K' && state[0] == 'R')   castling |= WhiteQueenSide;
+    if (state[60] == 'k' && state[63] == 'r') castling |= BlackKingSide;
+    if (state[60] == 'k' && state[56] == 'r') castling |= BlackQueenSide;
+    enPassant = NoSquare;
+    hash = computeHash();
+    pawnHash = computePawnHash();
+    psq = computePsq();
+}
+
+bool GameState::initFromFEN(const std::string& fen)
+{
+    std::istringstream fields(fen);
+    std::string placement, side = "w", castles = "-", enPassantSquare = "-";
+    fields >> placement >> side >> castles >> enPassantSquare;
+
+    char newState[64];
+    std::memset(newState, '0', sizeof(newState));
+    int file = 0;
+    int rank = 7;
+    for (char c : placement) {
+        if (c == '/') {
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else if (std::strchr("PNBRQKpnbrqk", c) && file < 8 && rank >= 0) {
+            newState[rank * 8 + file++] = c;
+        } else {
+            return false;
+        }
+    }
+    if (rank != 0 || (side != "w" && side != "b")) {
+        return false;
+    }
+    // the move generator needs one king a side and no pawn on a back rank
+    if (std::count(newState, newState + 64, 'K') != 1 || std::count(newState, newState + 64, 'k') != 1) {
+        return false;
+    }
+    for (int square = 0; square < 8; ++square) {
+        if (std::strchr("Pp", newState[square]) || std::strchr("Pp", newState[56 + square])) {
+            return false;
+        }
+    }
+
+    init(newState, side == "w" ? WHITE : BLACK);
+    // the side that just moved can't have left its king in check
+    if (inCheck(color == WHITE ? BLACK : WHITE)) {
+        return false;
+    }
+
+    // init() left the rights whose king and rook are on their home squares, a right the
+    // FEN names without them would castle an empty square
+    const unsigned char onBoard = castling;
+    castling = 0;
+    for (char c : castles) {
+        if (c == 'K') castling |= WhiteKingSide;
+        if (c == 'Q') castling |= WhiteQueenSide;
+        if (c == 'k') castling |= BlackKingSide;
+        if (c == 'q') castling |= BlackQueenSide;
+    }
+    castling &= onBoard;
+
+    // same rule as pushMove, only keep the square if a pawn can actually capture onto it
+    enPassant = NoSquare;
+    if (enPassantSquare.size() == 2 && enPassantSquare[0] >= 'a' && enPassantSquare[0] <= 'h' &&
+        (enPassantSquare[1] == '3' || enPassantSquare[1] == '6')) {
+        int square = (enPassantSquare[1] - '1') * 8 + (enPassantSquare[0] - 'a');
+        int us = (color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+        if (_pawnAttacks[color == WHITE ? 1 : 0][square].getData() & _bitboards[us].getData()) {
+            enPassant = (signed char)square;
+        }
+    }
+    hash = computeHash();
+    return true;
+}
+
+std::string moveToString(const BitMove& move)
+{
+    std::string text;
+    text += (char)('a' + move.from % 8);
+    text += (char)('1' + move.from / 8);
+    text += (char)('a' + move.to % 8);
+    text += (char)('1' + move.to / 8);
+    if (move.flags & IsPromotion) {
+        text += " pnbrqk"[move.promotionPiece()];
+    }
+    return text;
+}
+
+uint64_t GameState::computeHash() const
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 64; i++) {
+        key ^= Zobrist.pieces[bitboardForPiece[(unsigned char)state[i]]][i];
+    }
+    key ^= Zobrist.castling[castling];
+    if (enPassant != NoSquare) {
+        key ^= Zobrist.enPassantFile[enPassant & 7];
+    }
+    if (color == BLACK) {
+        key ^= Zobrist.sideToMove;
+    }
+    return key;
+}
+
+uint64_t GameState::computePawnHash() const
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 64; i++) {
+        const int board = bitboardForPiece[(unsigned char)state[i]];
+        if (board == WHITE_PAWNS || board == BLACK_PAWNS) {
+            key ^= Zobrist.pieces[board][i];
+        }
+    }
+    return key;
+}
+
+PsqScore GameState::computePsq() const
+{
+    PsqScore score;
+    for (int i = 0; i < 64; i++) {
+        if (state[i] != '0') {
+            score.add(bitboardForPiece[(unsigned char)state[i]], i);
+        }
+    }
+    return score;
+}
+
+// full rebuild from the mailbox, only needed when a new position is loaded.
+// after that pushMove keeps the bitboards up to date
+void GameState::rebuildBitboards()
+{
+    for (int i = 0; i < e_numBitboards; i++) {
+        _bitboards[i] = 0;
     }
+
+    for (int i = 0; i < 64; i++) {
+        _bitboards[bitboardForPiece[(unsigned char)state[i]]] |= 1ULL << i;
+    }
+
+    _bitboards[WHITE_ALL_PIECES] = _bitboards[WHITE_PAWNS].getData() | _bitboards[WHITE_KNIGHTS].getData() |
+    _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_ROOKS].getData() |
+    _bitboards[WHITE_QUEENS].getData() | _bitboards[WHITE_KING].getData();
+
+    _bitboards[BLACK_ALL_PIECES] = _bitboards[BLACK_PAWNS].getData() | _bitboards[BLACK_KNIGHTS].getData() |
+    _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_ROOKS].getData() |
+    _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
+
+    _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+    _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY].getData();
 }
 
 void GameState::shutdown() {
     cleanupMagicBitboards();
 }
 
-void GameState::addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift) {
+inline uint64_t GameState::pinMask(int square) const {
+    return ((_pinned >> square) & 1) ? _lineBetween[_kingSquare][square] : ~0ULL;
+}
+
+inline unsigned char GameState::captureFlag(int square) const {
+    const int enemies = (color == WHITE) ? BLACK_ALL_PIECES : WHITE_ALL_PIECES;
+    return ((_bitboards[enemies].getData() >> square) & 1) ? IsCapture : 0;
+}
+
+void GameState::addPawnBitboardMovesToList(MoveList& moves, const BitBoard bitboard, const int shift, unsigned char flags) {
     if (bitboard.getData() == 0)
         return;
     bitboard.forEachBit([&](int toSquare) {
         int fromSquare = toSquare - shift; // Correct calculation for fromSquare
-        moves.emplace_back(fromSquare, toSquare, Pawn);
+        if ((_pinned >> fromSquare) & 1 && !(pinMask(fromSquare) & (1ULL << toSquare)))
+            return;
+        moves.emplace_back(fromSquare, toSquare, Pawn, flags);
     });
 }
 
-void GameState::generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color) {
+void GameState::addPromotionsToList(MoveList& moves, const BitBoard bitboard, const int shift, unsigned char flags) {
+    if (bitboard.getData() == 0)
+        return;
+    bitboard.forEachBit([&](int toSquare) {
+        int fromSquare = toSquare - shift;
+        if ((_pinned >> fromSquare) & 1 && !(pinMask(fromSquare) & (1ULL << toSquare)))
+            return;
+        for (int promoted : { Queen, Knight, Rook, Bishop }) {
+            moves.emplace_back(fromSquare, toSquare, Pawn, flags | IsPromotion | (promoted << PromotionShift));
+        }
+    });
+}
+
+void GameState::generatePawnMoveList(MoveList& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color, uint64_t evasionMask) {
     if (pawns.getData() == 0)
         return;
 
-    BitBoard demoRight(NotAFile);
-    BitBoard demoLeft(NotHFile);
+    const uint64_t lastRank = (color == WHITE) ? Rank8 : Rank1;
 
     // Calculate single pawn moves forward
     BitBoard singleMoves = (color == WHITE) ? (pawns.getData() << 8) & emptySquares.getData() : (pawns.getData() >> 8) & emptySquares.getData();
@@ -78,78 +255,154 @@ void GameState::generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard
     BitBoard capturesLeft = (color == WHITE) ? ((pawns.getData() & NotAFile) << 7) & enemyPieces.getData() : ((pawns.getData() & NotAFile) >> 9) & enemyPieces.getData();
     BitBoard capturesRight = (color == WHITE) ? ((pawns.getData() & NotHFile) << 9) & enemyPieces.getData() : ((pawns.getData() & NotHFile) >> 7) & enemyPieces.getData();
 
+    // in check only blocks and captures of the checker are allowed
+    singleMoves &= evasionMask;
+    doubleMoves &= evasionMask;
+    capturesLeft &= evasionMask;
+    capturesRight &= evasionMask;
+
     int shiftForward = (color == WHITE) ? 8 : -8;
     int doubleShift = (color == WHITE) ? 16 : -16;
     int captureLeftShift = (color == WHITE) ? 7 : -9;
     int captureRightShift = (color == WHITE) ? 9 : -7;
     
     // Add single pawn moves to the list
-    addPawnBitboardMovesToList(moves, singleMoves, shiftForward);
+    addPawnBitboardMovesToList(moves, singleMoves & ~lastRank, shiftForward);
 
     // Add double pawn moves to the list
     addPawnBitboardMovesToList(moves, doubleMoves, doubleShift);
 
     // Add pawn captures to the list
-    addPawnBitboardMovesToList(moves, capturesLeft, captureLeftShift);
-    addPawnBitboardMovesToList(moves, capturesRight, captureRightShift);
+    addPawnBitboardMovesToList(moves, capturesLeft & ~lastRank, captureLeftShift, IsCapture);
+    addPawnBitboardMovesToList(moves, capturesRight & ~lastRank, captureRightShift, IsCapture);
+
+    // pawns reaching the last rank promote, one move per piece
+    addPromotionsToList(moves, singleMoves & lastRank, shiftForward);
+    addPromotionsToList(moves, capturesLeft & lastRank, captureLeftShift, IsCapture);
+    addPromotionsToList(moves, capturesRight & lastRank, captureRightShift, IsCapture);
+}
+
+void GameState::generateEnPassant(MoveList& moves, uint64_t evasionMask) {
+    if (enPassant == NoSquare)
+        return;
+
+    const int captureSquare = (color == WHITE) ? enPassant - 8 : enPassant + 8;
+    const uint64_t captureMask = 1ULL << captureSquare;
+    // in check, en passant only helps if it removes the checking pawn
+    if (!((evasionMask & (1ULL << enPassant)) || (evasionMask & captureMask & _checkers)))
+        return;
+
+    const int us = (color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+    const int them = (color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS;
+    // our pawns that attack the en passant square are the ones an enemy pawn there would attack
+    BitBoard capturers = _pawnAttacks[color == WHITE ? 1 : 0][enPassant] & _bitboards[us];
+
+    capturers.forEachBit([&](int fromSquare) {
+        // two pawns leave the same rank at once, which the pin mask can't see. just play
+        // it out on the occupancy and look for a slider hitting the king.
+        const uint64_t occupancy = (_bitboards[OCCUPANCY].getData() ^ (1ULL << fromSquare) ^ captureMask) | (1ULL << enPassant);
+        const uint64_t enemyDiagonals = _bitboards[WHITE_BISHOPS + them].getData() | _bitboards[WHITE_QUEENS + them].getData();
+        const uint64_t enemyStraights = _bitboards[WHITE_ROOKS + them].getData() | _bitboards[WHITE_QUEENS + them].getData();
+        if (getBishopAttacks(_kingSquare, occupancy) & enemyDiagonals)
+            return;
+        if (getRookAttacks(_kingSquare, occupancy) & enemyStraights)
+            return;
+        // a knight or pawn check other than the captured pawn is still there afterwards
+        if (_checkers & ~captureMask & (_bitboards[WHITE_KNIGHTS + them].getData() | _bitboards[WHITE_PAWNS + them].getData()))
+            return;
+        moves.emplace_back(fromSquare, enPassant, Pawn, EnPassant | IsCapture);
+    });
 }
 
 // Generate actual move objects from a bitboard
-void GameState::generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy) {
+void GameState::generateKnightMoves(MoveList& moves, BitBoard knightBoard, uint64_t targets) {
     knightBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KnightAttacks[fromSquare] & occupancy);
+        BitBoard moveBitboard = BitBoard(KnightAttacks[fromSquare] & targets);
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Knight);
+           moves.emplace_back(fromSquare, toSquare, Knight, captureFlag(toSquare));
         });
     });
 }
 
 // Generate actual move objects from a bitboard
-void GameState::generateKingMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy) {
+void GameState::generateKingMoves(MoveList& moves, BitBoard piecesBoard, uint64_t targets) {
+    const char opponentColor = (color == WHITE) ? BLACK : WHITE;
+    // take the king off the board so a slider checking it also covers the square behind it
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData() & ~piecesBoard.getData();
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KingAttacks[fromSquare] & occupancy);
+        BitBoard moveBitboard = BitBoard(KingAttacks[fromSquare] & targets);
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, King);
+            if (!isSquareAttacked(toSquare, opponentColor, occupancy)) {
+                moves.emplace_back(fromSquare, toSquare, King, captureFlag(toSquare));
+            }
         });
     });
 }
 
 // Generate actual move objects from a bitboard
-void GameState::generateBishopMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateBishopMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getBishopAttacks(fromSquare, occupancy) & ~friendlies);
+        BitBoard moveBitboard = BitBoard(getBishopAttacks(fromSquare, occupancy) & targets & pinMask(fromSquare));
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Bishop);
+           moves.emplace_back(fromSquare, toSquare, Bishop, captureFlag(toSquare));
         });
     });
 }
 
-void GameState::generateRooksMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateRooksMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getRookAttacks(fromSquare, occupancy) & ~friendlies);
+        BitBoard moveBitboard = BitBoard(getRookAttacks(fromSquare, occupancy) & targets & pinMask(fromSquare));
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Rook);
+           moves.emplace_back(fromSquare, toSquare, Rook, captureFlag(toSquare));
         });
     });
 }
 
-void GameState::generateQueensMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateQueensMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getQueenAttacks(fromSquare, occupancy) & ~friendlies);
+        BitBoard moveBitboard = BitBoard(getQueenAttacks(fromSquare, occupancy) & targets & pinMask(fromSquare));
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Queen);
+           moves.emplace_back(fromSquare, toSquare, Queen, captureFlag(toSquare));
         });
     });
 }
 
+void GameState::generateCastles(MoveList& moves)
+{
+    const bool white = (color == WHITE);
+    const unsigned char kingSide = white ? WhiteKingSide : BlackKingSide;
+    const unsigned char queenSide = white ? WhiteQueenSide : BlackQueenSide;
+    if (!(castling & (kingSide | queenSide)))
+        return;
+
+    const int base = white ? 0 : 56;
+    const char opponentColor = white ? BLACK : WHITE;
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+
+    // the squares between king and rook must be empty and the king may not pass
+    // through or land on an attacked square. not being in check is the caller's job.
+    if ((castling & kingSide) &&
+        !(occupancy & (0x60ULL << base)) &&
+        !isSquareAttacked(base + 5, opponentColor, occupancy) &&
+        !isSquareAttacked(base + 6, opponentColor, occupancy)) {
+        moves.emplace_back(base + 4, base + 6, King, KingSideCastle);
+    }
+    if ((castling & queenSide) &&
+        !(occupancy & (0x0EULL << base)) &&
+        !isSquareAttacked(base + 3, opponentColor, occupancy) &&
+        !isSquareAttacked(base + 2, opponentColor, occupancy)) {
+        moves.emplace_back(base + 4, base + 2, King, QueenSideCastle);
+    }
+}
+
 template <ChessPiece PIECE_TYPE>
 inline BitBoard generatePieceAttackList(
     const BitBoard pieces, 
@@ -228,20 +481,17 @@ const BitBoard GameState::generatePawnAttacks(const BitBoard pawns, char color)
 }
 
 // Returns true if 'square' is attacked by any piece belonging to 'attackerColor'
-bool GameState::isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]) {
+bool GameState::isSquareAttacked(int square, char attackerColor, uint64_t occupancy) const {
 	const int pawnIdx   = (attackerColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
 	const int knightIdx = (attackerColor == WHITE) ? WHITE_KNIGHTS : BLACK_KNIGHTS;
 	const int bishopIdx = (attackerColor == WHITE) ? WHITE_BISHOPS : BLACK_BISHOPS;
 	const int rookIdx   = (attackerColor == WHITE) ? WHITE_ROOKS : BLACK_ROOKS;
 	const int queenIdx  = (attackerColor == WHITE) ? WHITE_QUEENS : BLACK_QUEENS;
 	const int kingIdx   = (attackerColor == WHITE) ? WHITE_KING : BLACK_KING;
+	const BitBoard (&boards)[e_numBitboards] = _bitboards;
 
-	// Get Occupancy of all pieces for sliding checks
-	BitBoard occ = boards[OCCUPANCY];
-
-	// Check Pawn Attacks
-	char targetColor = (attackerColor == WHITE) ? BLACK : WHITE; 
-	if ((generatePawnAttacksBitBoard(square, targetColor) & boards[pawnIdx].getData()) != 0) return true;
+	// Check Pawn Attacks, a pawn of the defending color on 'square' attacks exactly the attacking pawns
+	if ((_pawnAttacks[attackerColor == WHITE ? 1 : 0][square].getData() & boards[pawnIdx].getData()) != 0) return true;
 
 	// Check Knight Attacks
 	if ((KnightAttacks[square] & boards[knightIdx].getData()) != 0) return true;
@@ -250,131 +500,134 @@ bool GameState::isSquareAttacked(int square, char attackerColor, const BitBoard
 	if ((KingAttacks[square] & boards[kingIdx].getData()) != 0) return true;
 
 	// Check Bishop/Queen (Diagonal) Attacks
-	uint64_t diagonalAttacks = getBishopAttacks(square, occ.getData());
+	uint64_t diagonalAttacks = getBishopAttacks(square, occupancy);
 	if ((diagonalAttacks & (boards[bishopIdx].getData() | boards[queenIdx].getData())) != 0) return true;
 
 	// Check Rook/Queen (Straight) Attacks
-	uint64_t straightAttacks = getRookAttacks(square, occ.getData());
+	uint64_t straightAttacks = getRookAttacks(square, occupancy);
 	if ((straightAttacks & (boards[rookIdx].getData() | boards[queenIdx].getData())) != 0) return true;
 
 	return false;
 }
 
-void GameState::filterOutIllegalMoves(std::vector<BitMove>& moves) {
-	if (moves.empty()) return;
-
-	const char myColor = color;
-	const char opponentColor = (color == WHITE) ? BLACK : WHITE;
-	const int myKingIdx = (myColor == WHITE) ? WHITE_KING : BLACK_KING;
-
-	// Remove moves that leave the king in check
-	moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const BitMove& move) {
-		
-		// Create a temporary copy of the board state
-		BitBoard tempBoards[e_numBitboards];
-		for (int i = 0; i < e_numBitboards; ++i) tempBoards[i] = _bitboards[i];
-
-		// Apply the move to the temporary boards
-		// Note: We just need occupancy correct for check detection.
-		
-		const uint64_t fromMask = 1ULL << move.from;
-		const uint64_t toMask   = 1ULL << move.to;
-		
-		// Helper to determine which bitboard a piece belongs to
-		auto getPieceIdx = [&](ChessPiece p, char c) {
-			if (p == Pawn) return c == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-			if (p == Knight) return c == WHITE ? WHITE_KNIGHTS : BLACK_KNIGHTS;
-			if (p == Bishop) return c == WHITE ? WHITE_BISHOPS : BLACK_BISHOPS;
-			if (p == Rook) return c == WHITE ? WHITE_ROOKS : BLACK_ROOKS;
-			if (p == Queen) return c == WHITE ? WHITE_QUEENS : BLACK_QUEENS;
-			return c == WHITE ? WHITE_KING : BLACK_KING; // King
-		};
-
-		int moverIdx = getPieceIdx(static_cast<ChessPiece>(move.piece), myColor);
-		
-		// Remove from 'from'
-		tempBoards[moverIdx] &= ~fromMask;
-		tempBoards[OCCUPANCY] &= ~fromMask;
-
-		// Handle Captures (Remove opponent piece at 'to')
-		// We scan opponent boards to find what was captured (slower than lookup, but safe for generic bitboards)
-		int startOpp = (opponentColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
-		int endOpp   = (opponentColor == WHITE) ? WHITE_KING : BLACK_KING;
-		
-		// Specialized handling for En Passant
-		if (move.flags & EnPassant) {
-			int capSq = (myColor == WHITE) ? (move.to - 8) : (move.to + 8);
-			uint64_t capMask = 1ULL << capSq;
-			tempBoards[startOpp] &= ~capMask; // Opponent Pawns
-			tempBoards[OCCUPANCY] &= ~capMask;
-		} else {
-			// Standard capture
-			for (int i = startOpp; i <= endOpp; ++i) {
-				tempBoards[i] &= ~toMask;
-			}
-			tempBoards[OCCUPANCY] &= ~toMask; // Clear strictly to ensure no overlap before adding
-		}
-
-		// Handle Promotion
-		if ((move.flags & IsPromotion)) {
-			moverIdx = getPieceIdx(Queen, myColor); // Assume Queen promotion for check safety (mostly covers it)
-		}
-
-		// Add to 'to'
-		tempBoards[moverIdx] |= toMask;
-		tempBoards[OCCUPANCY] |= toMask;
-
-		// Handle King Move (Update King Index tracking)
-		int currentKingSquare = -1;
-		if (move.piece == King) {
-			currentKingSquare = move.to;
-		} else {
-			// If king didn't move, find him
-			currentKingSquare = tempBoards[myKingIdx].firstBit();
-		}
-
-		// If the King is attacked by the opponent after this move, the move is illegal.
-		return isSquareAttacked(currentKingSquare, opponentColor, tempBoards);
-
-	}), moves.end());
+uint64_t GameState::attackersTo(int square, uint64_t occupancy) const {
+    const uint64_t diagonals = _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_QUEENS].getData() |
+                               _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_QUEENS].getData();
+    const uint64_t straights = _bitboards[WHITE_ROOKS].getData() | _bitboards[WHITE_QUEENS].getData() |
+                               _bitboards[BLACK_ROOKS].getData() | _bitboards[BLACK_QUEENS].getData();
+    // a pawn of one colour on the square attacks exactly the pawns of the other colour that attack it
+    return (_pawnAttacks[1][square].getData() & _bitboards[WHITE_PAWNS].getData()) |
+           (_pawnAttacks[0][square].getData() & _bitboards[BLACK_PAWNS].getData()) |
+           (KnightAttacks[square] & (_bitboards[WHITE_KNIGHTS].getData() | _bitboards[BLACK_KNIGHTS].getData())) |
+           (KingAttacks[square] & (_bitboards[WHITE_KING].getData() | _bitboards[BLACK_KING].getData())) |
+           (getBishopAttacks(square, occupancy) & diagonals) |
+           (getRookAttacks(square, occupancy) & straights);
 }
 
-std::vector<BitMove> GameState::generateAllMoves()
+// finds the pieces checking our king and our pieces pinned against it, once per position
+void GameState::updateCheckInfo()
 {
-    std::vector<BitMove> moves;
-    moves.reserve(32);
+    const int us = (color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+    const int them = (color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    const uint64_t enemyDiagonals = _bitboards[WHITE_BISHOPS + them].getData() | _bitboards[WHITE_QUEENS + them].getData();
+    const uint64_t enemyStraights = _bitboards[WHITE_ROOKS + them].getData() | _bitboards[WHITE_QUEENS + them].getData();
+
+    _kingSquare = _bitboards[WHITE_KING + us].firstBit();
+    _checkers = (_pawnAttacks[color == WHITE ? 0 : 1][_kingSquare].getData() & _bitboards[WHITE_PAWNS + them].getData()) |
+                (KnightAttacks[_kingSquare] & _bitboards[WHITE_KNIGHTS + them].getData()) |
+                (getBishopAttacks(_kingSquare, occupancy) & enemyDiagonals) |
+                (getRookAttacks(_kingSquare, occupancy) & enemyStraights);
+
+    // sliders that would see the king on an empty board, with exactly one piece in
+    // between. if that piece is ours it is pinned.
+    _pinned = 0;
+    BitBoard snipers((getBishopAttacks(_kingSquare, 0) & enemyDiagonals) | (getRookAttacks(_kingSquare, 0) & enemyStraights));
+    snipers.forEachBit([&](int sniper) {
+        uint64_t blockers = _squaresBetween[_kingSquare][sniper] & occupancy;
+        if (blockers && !(blockers & (blockers - 1))) {
+            _pinned |= blockers & _bitboards[WHITE_ALL_PIECES + us].getData();
+        }
+    });
+}
 
-    for (int i=0; i<e_numBitboards; i++) {
-        _bitboards[i] = 0;
-    }
+void GameState::generatePieceMoves(MoveList& moves, uint64_t evasionMask)
+{
+    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    int oppBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    const uint64_t targets = ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData() & evasionMask;
+
+    // a pinned knight can never stay on the pin line
+    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex] & ~_pinned, targets);
+    generatePawnMoveList(moves, _bitboards[WHITE_PAWNS  + bitIndex], ~occupancy, _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData(), color, evasionMask);
+    generateEnPassant(moves, evasionMask);
+    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], occupancy, targets);
+    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], occupancy, targets);
+    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], occupancy, targets);
+}
 
-    for(int i = 0; i<64; i++) {
-        int bitIndex = _bitboardLookup[(unsigned char)state[i]];
-        _bitboards[bitIndex] |= 1ULL << i;
-    }
+// only called in check: king steps, and against a single checker also captures and blocks
+void GameState::generateEvasions(MoveList& moves)
+{
+    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
 
-    _bitboards[WHITE_ALL_PIECES] = _bitboards[WHITE_PAWNS].getData() | _bitboards[WHITE_KNIGHTS].getData() |
-    _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_ROOKS].getData() |
-    _bitboards[WHITE_QUEENS].getData() | _bitboards[WHITE_KING].getData();
+    // double check, only the king can move
+    if (_checkers & (_checkers - 1))
+        return;
 
-    _bitboards[BLACK_ALL_PIECES] = _bitboards[BLACK_PAWNS].getData() | _bitboards[BLACK_KNIGHTS].getData() |
-    _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_ROOKS].getData() |
-    _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
-    
-    _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+    const int checker = BitBoard(_checkers).firstBit();
+    generatePieceMoves(moves, _checkers | _squaresBetween[_kingSquare][checker]);
+}
 
-    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-    int oppBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+std::vector<BitMove> GameState::generateAllMoves()
+{
+    MoveList moves;
+    generateAllMoves(moves);
+    return std::vector<BitMove>(moves.begin(), moves.end());
+}
 
-    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generatePawnMoveList(moves, _bitboards[WHITE_PAWNS  + bitIndex], ~_bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData(), color);
-    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
+// legal move generation: checkers and pins are worked out once, then every
+// generator only emits moves that keep the king safe
+void GameState::generateAllMoves(MoveList& moves)
+{
+    moves.clear();
+    updateCheckInfo();
 
-    filterOutIllegalMoves(moves);
+    if (_checkers) {
+        generateEvasions(moves);
+        return;
+    }
 
-    return moves;
+    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
+    generateCastles(moves);
+    generatePieceMoves(moves, ~0ULL);
 }
 
+void GameState::generateCaptures(MoveList& moves)
+{
+    moves.clear();
+    updateCheckInfo();
+
+    if (_checkers) {
+        generateEvasions(moves);
+        return;
+    }
+
+    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    int oppBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    const uint64_t enemies = _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData();
+    const uint64_t lastRank = (color == WHITE) ? Rank8 : Rank1;
+
+    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], enemies);
+    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex] & ~_pinned, enemies);
+    // pushes only survive the mask when they land on the last rank
+    generatePawnMoveList(moves, _bitboards[WHITE_PAWNS + bitIndex], ~occupancy, enemies, color, enemies | lastRank);
+    generateEnPassant(moves, ~0ULL);
+    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], occupancy, enemies);
+    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], occupancy, enemies);
+    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], occupancy, enemies);
+}
@@ -5,17 +5,27 @@
 #include <cstring>
 #include <cstdint>
 #include <vector>
+#include <string>
+#include <new>
+#include <utility>
 #include "Bitboard.h"
+#include "Zobrist.h"
+#include "PieceSquareTables.h"
 
 constexpr int WHITE = +1;
 constexpr int BLACK = -1;
-// Define a constant for the maximum depth of your AI.
-constexpr int MAX_DEPTH = 24;
+// undo records a GameState makes room for up front. the stack grows past this when it
+// has to, so neither a long game nor a deep search runs into a ceiling.
+constexpr int UNDO_RESERVE = 256;
 // Define constants for ranks and files
 constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask
 constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask
 constexpr uint64_t Rank3(0x0000000000FF0000ULL); // Rank 3 mask
 constexpr uint64_t Rank6(0x0000FF0000000000ULL); // Rank 6 mask
+constexpr uint64_t Rank1(0x00000000000000FFULL); // Rank 1 mask
+constexpr uint64_t Rank8(0xFF00000000000000ULL); // Rank 8 mask
+constexpr uint64_t FileA(0x0101010101010101ULL); // A file
+constexpr uint64_t FileH(0x8080808080808080ULL); // H file
 
 enum AllBitBoards
 {
@@ -38,6 +48,16 @@ enum AllBitBoards
     e_numBitboards
 };
 
+enum CastlingRights {
+    WhiteKingSide = 0x01,
+    WhiteQueenSide = 0x02,
+    BlackKingSide = 0x04,
+    BlackQueenSide = 0x08,
+    AllCastling = 0x0F
+};
+
+constexpr int NoSquare = -1;
+
 enum MoveFlags {
     EnPassant = 0x01, // 0000 0001
     IsCapture = 0x02, // 0000 0010
@@ -45,6 +65,8 @@ enum MoveFlags {
     QueenSideCastle = 0x08, // 0000 1000
     IsPromotion = 0x10 // 0001 0000
 };
+// the promoted piece lives in the top three flag bits, a bare IsPromotion means queen
+constexpr int PromotionShift = 5;
 
 #pragma pack(push, 1)
 struct BitMove {
@@ -57,6 +79,12 @@ struct BitMove {
         : from(from), to(to), piece(piece), flags(flags) { }
         
     BitMove() : from(0), to(0), piece(NoPiece), flags(0) { }
+
+    ChessPiece promotionPiece() const {
+        if (!(flags & IsPromotion)) return NoPiece;
+        int promoted = flags >> PromotionShift;
+        return promoted ? static_cast<ChessPiece>(promoted) : Queen;
+    }
     
     bool operator==(const BitMove& other) const {
         return from == other.from && 
@@ -67,97 +95,368 @@ struct BitMove {
 };
 #pragma pack(pop)
 
+constexpr const char* StartPositionFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// long algebraic notation as used by UCI, e.g. e2e4 or e7e8q
+std::string moveToString(const BitMove& move);
+
+// fixed capacity move list that lives on the stack of whoever generates moves.
+// no legal chess position has more than 218 moves, 256 leaves room for pseudo-legal ones.
+class MoveList {
+public:
+    static constexpr int MaxMoves = 256;
+
+    // the storage is deliberately left uninitialized, only [0, count) is ever read
+    MoveList() : _count(0) { }
+
+    template <typename... Args>
+    inline void emplace_back(Args&&... args) {
+        assert(_count < MaxMoves);
+        new (&_moves[_count++]) BitMove(std::forward<Args>(args)...);
+    }
+    inline void push_back(const BitMove& move) { emplace_back(move); }
+
+    void clear() { _count = 0; }
+    // drops everything from newEnd on, used after std::remove_if style compaction
+    void truncate(BitMove* newEnd) { _count = (int)(newEnd - _moves); }
+
+    int size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    BitMove& operator[](int i) { return _moves[i]; }
+    const BitMove& operator[](int i) const { return _moves[i]; }
+    BitMove* begin() { return _moves; }
+    BitMove* end() { return _moves + _count; }
+    const BitMove* begin() const { return _moves; }
+    const BitMove* end() const { return _moves + _count; }
+
+private:
+    union {
+        BitMove _moves[MaxMoves];
+    };
+    int _count;
+};
+
+// maps a board character to its piece bitboard, empty squares map to EMPTY_SQUARES
+struct PieceBitboardLookup {
+    int index[128];
+
+    constexpr PieceBitboardLookup() : index() {
+        for (int i = 0; i < 128; ++i) { index[i] = EMPTY_SQUARES; }
+        index['P'] = WHITE_PAWNS;
+        index['N'] = WHITE_KNIGHTS;
+        index['B'] = WHITE_BISHOPS;
+        index['R'] = WHITE_ROOKS;
+        index['Q'] = WHITE_QUEENS;
+        index['K'] = WHITE_KING;
+        index['p'] = BLACK_PAWNS;
+        index['n'] = BLACK_KNIGHTS;
+        index['b'] = BLACK_BISHOPS;
+        index['r'] = BLACK_ROOKS;
+        index['q'] = BLACK_QUEENS;
+        index['k'] = BLACK_KING;
+    }
+    constexpr int operator[](unsigned char piece) const { return index[piece & 127]; }
+};
+inline constexpr PieceBitboardLookup bitboardForPiece;
+
 struct alignas(32) GameStateData {
     char state[64];                 // persisitent
     int flags;
     char color;                     // BLACK or WHITE
+    unsigned char castling;         // CastlingRights still available
+    signed char enPassant;          // square a pawn can capture onto, NoSquare if none
+    uint64_t hash;                  // zobrist key of everything above
+    uint64_t pawnHash;              // zobrist key of the pawns alone, for the pawn table
+    PsqScore psq;                   // material and piece-square sums, kept by pushMove
+    // kept in step with state[] by pushMove, popState moves the changed bits back from the UndoRecord
+    BitBoard _bitboards[e_numBitboards];
 
     GameStateData() : flags(0)
-        , color(WHITE) {
+        , color(WHITE)
+        , castling(0)
+        , enPassant(NoSquare)
+        , hash(0)
+        , pawnHash(0) {
         std::memset(state, '0', sizeof(state));
     }
     GameStateData(const GameStateData&) = default;
     GameStateData& operator=(const GameStateData&) = default;
 };
 
+// what pushMove can't work out backwards: the pieces involved and the fields it overwrites.
+// a fraction of a GameStateData, so make/unmake moves far less memory than a snapshot.
+struct UndoRecord {
+    BitMove move;
+    char moved;                     // the piece on move.from, a pawn for a promotion
+    char captured;                  // what was taken, the pawn for en passant, '0' for nothing
+    unsigned char castling;
+    signed char enPassant;
+    int flags;
+    uint64_t hash;
+    uint64_t pawnHash;
+    PsqScore psq;
+};
+
 class GameState : public GameStateData {
 public:
-    GameStateData stateStack[MAX_DEPTH];
-    int stackPtr = 0;
+    int stackPtr = 0;               // moves made since init, popState takes back the last
 
-    uint64_t _zobristHash[2]; // when one hash value is made, the other is made as well because it's just a xor of the first by the color bit
-    BitBoard _bitboards[e_numBitboards];
     BitBoard _attackBitBoard;
 
-    GameState() : stackPtr(0) { }
+    GameState() : stackPtr(0), _undo(UNDO_RESERVE) { }
+
+    // record of the move made from the position ply plies after init, ply < stackPtr
+    const UndoRecord& undoAt(int ply) const { return _undo[ply]; }
+    // zobrist key of the position ply plies after init, ply <= stackPtr
+    uint64_t hashAt(int ply) const { return ply == stackPtr ? hash : _undo[ply].hash; }
+
+    // tools/movegen_bench times the private generators one at a time
+    friend class MoveGenBench;
 
     void init(const char* newState, char player);
+    // full FEN including castling rights and en passant square. returns false if it can't be
+    // parsed or isn't a legal position: one king a side, no pawn on rank 1 or 8, and the side
+    // not to move not in check
+    bool initFromFEN(const std::string& fen);
 
     inline void pushMove(const BitMove& move) {
-        pushState();
+        if (stackPtr == (int)_undo.size()) {
+            _undo.resize(_undo.size() * 2);
+        }
+        UndoRecord& undo = _undo[stackPtr++];
+        undo.move = move;
+        undo.moved = state[move.from];
+        undo.captured = state[move.to];
+        undo.castling = castling;
+        undo.enPassant = enPassant;
+        undo.flags = flags;
+        undo.hash = hash;
+        undo.pawnHash = pawnHash;
+        undo.psq = psq;
+
+        const uint64_t fromMask = 1ULL << move.from;
+        const uint64_t toMask = 1ULL << move.to;
+        const int friendlies = (color == WHITE) ? WHITE_ALL_PIECES : BLACK_ALL_PIECES;
+        const int enemies = (color == WHITE) ? BLACK_ALL_PIECES : WHITE_ALL_PIECES;
+
         unsigned char fromPiece = state[move.from];
+        unsigned char toPiece = state[move.to];
+        const int moverBoard = bitboardForPiece[fromPiece];
+        _bitboards[moverBoard] ^= fromMask | toMask;
+        _bitboards[friendlies] ^= fromMask | toMask;
+        hash ^= Zobrist.pieces[moverBoard][move.from] ^ Zobrist.pieces[moverBoard][move.to];
+        psq.move(moverBoard, move.from, move.to);
+        const bool pawnMove = (moverBoard == WHITE_PAWNS || moverBoard == BLACK_PAWNS);
+        if (pawnMove) {
+            pawnHash ^= Zobrist.pieces[moverBoard][move.from] ^ Zobrist.pieces[moverBoard][move.to];
+        }
+        if (toPiece != '0') {
+            const int capturedBoard = bitboardForPiece[toPiece];
+            _bitboards[capturedBoard] ^= toMask;
+            _bitboards[enemies] ^= toMask;
+            hash ^= Zobrist.pieces[capturedBoard][move.to];
+            psq.remove(capturedBoard, move.to);
+            if (capturedBoard == WHITE_PAWNS || capturedBoard == BLACK_PAWNS) {
+                pawnHash ^= Zobrist.pieces[capturedBoard][move.to];
+            }
+        }
+
         state[move.from] = '0';
         state[move.to] = fromPiece;
         if (move.flags & KingSideCastle) {
+            const int rookBoard = moverBoard + (WHITE_ROOKS - WHITE_KING);
+            const uint64_t rookMask = (1ULL << (move.to + 1)) | (1ULL << (move.to - 1));
+            _bitboards[rookBoard] ^= rookMask;
+            _bitboards[friendlies] ^= rookMask;
+            hash ^= Zobrist.pieces[rookBoard][move.to + 1] ^ Zobrist.pieces[rookBoard][move.to - 1];
+            psq.move(rookBoard, move.to + 1, move.to - 1);
             state[move.to - 1] = state[move.to + 1];
             state[move.to + 1] = '0';
         } else if (move.flags & QueenSideCastle) {
+            const int rookBoard = moverBoard + (WHITE_ROOKS - WHITE_KING);
+            const uint64_t rookMask = (1ULL << (move.to - 2)) | (1ULL << (move.to + 1));
+            _bitboards[rookBoard] ^= rookMask;
+            _bitboards[friendlies] ^= rookMask;
+            hash ^= Zobrist.pieces[rookBoard][move.to - 2] ^ Zobrist.pieces[rookBoard][move.to + 1];
+            psq.move(rookBoard, move.to - 2, move.to + 1);
             state[move.to + 1] = state[move.to - 2];
             state[move.to - 2] = '0';
         } else if (move.flags & EnPassant) {
             // check for color to determine which direction to capture
-            if (fromPiece == 'P') {
-                state[move.to - 8] = '0';
-            } else {
-                state[move.to + 8] = '0';
-            }
+            const int captureSquare = (fromPiece == 'P') ? move.to - 8 : move.to + 8;
+            const uint64_t captureMask = 1ULL << captureSquare;
+            const int capturedBoard = bitboardForPiece[(unsigned char)state[captureSquare]];
+            undo.captured = state[captureSquare];
+            _bitboards[capturedBoard] ^= captureMask;
+            _bitboards[enemies] ^= captureMask;
+            hash ^= Zobrist.pieces[capturedBoard][captureSquare];
+            pawnHash ^= Zobrist.pieces[capturedBoard][captureSquare];
+            psq.remove(capturedBoard, captureSquare);
+            state[captureSquare] = '0';
         } else if (move.flags & IsPromotion) {
-            state[move.to] = color == WHITE ? 'Q' : 'q';
+            const ChessPiece promoted = move.promotionPiece();
+            state[move.to] = (color == WHITE ? " PNBRQK" : " pnbrqk")[promoted];
+            const int promotedBoard = moverBoard + (promoted - Pawn);
+            _bitboards[moverBoard] ^= toMask;
+            _bitboards[promotedBoard] ^= toMask;
+            hash ^= Zobrist.pieces[moverBoard][move.to] ^ Zobrist.pieces[promotedBoard][move.to];
+            pawnHash ^= Zobrist.pieces[moverBoard][move.to];
+            psq.remove(moverBoard, move.to);
+            psq.add(promotedBoard, move.to);
         }
+        _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES] | _bitboards[BLACK_ALL_PIECES];
+        _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY];
+
+        // a king or rook leaving (or a rook being captured on) its home square drops the right
+        const unsigned char newCastling = castling & castlingMask(move.from) & castlingMask(move.to);
+        hash ^= Zobrist.castling[castling] ^ Zobrist.castling[newCastling];
+        castling = newCastling;
+
+        if (enPassant != NoSquare) {
+            hash ^= Zobrist.enPassantFile[enPassant & 7];
+            enPassant = NoSquare;
+        }
+        // only remember a double push when an enemy pawn is actually beside it, so
+        // transpositions that differ only by an unusable en passant square hash the same
+        if (pawnMove) {
+            if (move.to - move.from == 16 || move.from - move.to == 16) {
+                const uint64_t beside = ((toMask << 1) & NotAFile) | ((toMask >> 1) & NotHFile);
+                if (beside & _bitboards[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS].getData()) {
+                    enPassant = (move.from + move.to) / 2;
+                    hash ^= Zobrist.enPassantFile[enPassant & 7];
+                }
+            }
+        }
+
         // flip the color bit as it now becomes the other player's turn
         color = (color == WHITE) ? BLACK : WHITE;
+        hash ^= Zobrist.sideToMove;
         flags = 0; // invalidate all the flags
     }
 
-    inline void pushState() {
-        assert(stackPtr < MAX_DEPTH);
-        stateStack[stackPtr++] = static_cast<const GameStateData&>(*this);
+    static constexpr unsigned char castlingMask(int square) {
+        switch (square) {
+            case 0:  return AllCastling & ~WhiteQueenSide;
+            case 4:  return AllCastling & ~(WhiteKingSide | WhiteQueenSide);
+            case 7:  return AllCastling & ~WhiteKingSide;
+            case 56: return AllCastling & ~BlackQueenSide;
+            case 60: return AllCastling & ~(BlackKingSide | BlackQueenSide);
+            case 63: return AllCastling & ~BlackKingSide;
+            default: return AllCastling;
+        }
     }
+
+    // takes back the last pushMove: pieces are moved back, the rest comes from its record
     inline void popState() {
         assert(stackPtr > 0);
-        static_cast<GameStateData&>(*this) = stateStack[--stackPtr];
+        const UndoRecord& undo = _undo[--stackPtr];
+        const BitMove& move = undo.move;
+        color = (color == WHITE) ? BLACK : WHITE;
+
+        const uint64_t fromMask = 1ULL << move.from;
+        const uint64_t toMask = 1ULL << move.to;
+        const int friendlies = (color == WHITE) ? WHITE_ALL_PIECES : BLACK_ALL_PIECES;
+        const int enemies = (color == WHITE) ? BLACK_ALL_PIECES : WHITE_ALL_PIECES;
+        const int moverBoard = bitboardForPiece[(unsigned char)undo.moved];
+
+        if (move.flags & KingSideCastle) {
+            const int rookBoard = moverBoard + (WHITE_ROOKS - WHITE_KING);
+            const uint64_t rookMask = (1ULL << (move.to + 1)) | (1ULL << (move.to - 1));
+            _bitboards[rookBoard] ^= rookMask;
+            _bitboards[friendlies] ^= rookMask;
+            state[move.to + 1] = state[move.to - 1];
+            state[move.to - 1] = '0';
+        } else if (move.flags & QueenSideCastle) {
+            const int rookBoard = moverBoard + (WHITE_ROOKS - WHITE_KING);
+            const uint64_t rookMask = (1ULL << (move.to - 2)) | (1ULL << (move.to + 1));
+            _bitboards[rookBoard] ^= rookMask;
+            _bitboards[friendlies] ^= rookMask;
+            state[move.to - 2] = state[move.to + 1];
+            state[move.to + 1] = '0';
+        } else if (move.flags & IsPromotion) {
+            const int promotedBoard = moverBoard + (move.promotionPiece() - Pawn);
+            _bitboards[promotedBoard] ^= toMask;
+            _bitboards[moverBoard] ^= toMask;
+        }
+
+        _bitboards[moverBoard] ^= fromMask | toMask;
+        _bitboards[friendlies] ^= fromMask | toMask;
+        state[move.from] = undo.moved;
+        state[move.to] = '0';
+        if (undo.captured != '0') {
+            const int captureSquare = (move.flags & EnPassant) ? ((color == WHITE) ? move.to - 8 : move.to + 8) : move.to;
+            const uint64_t captureMask = 1ULL << captureSquare;
+            _bitboards[bitboardForPiece[(unsigned char)undo.captured]] ^= captureMask;
+            _bitboards[enemies] ^= captureMask;
+            state[captureSquare] = undo.captured;
+        }
+        _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES] | _bitboards[BLACK_ALL_PIECES];
+        _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY];
+
+        castling = undo.castling;
+        enPassant = undo.enPassant;
+        flags = undo.flags;
+        hash = undo.hash;
+        pawnHash = undo.pawnHash;
+        psq = undo.psq;
     }
 
     bool inCheck(char kingColor) 
     {
-        char kingChar = (kingColor == WHITE) ? 'K' : 'k';
-        int ksq = -1;
-        for (int i = 0; i < 64; ++i) 
-        {
-            if (state[i] == kingChar) { ksq = i; break; }
-        }
-        if (ksq < 0) return false;
+        const BitBoard& king = _bitboards[(kingColor == WHITE) ? WHITE_KING : BLACK_KING];
+        if (king.getData() == 0) return false;
 
         char attacker = (kingColor == WHITE) ? BLACK : WHITE;
-        return isSquareAttacked(ksq, attacker, _bitboards);
+        return isSquareAttacked(king.firstBit(), attacker, _bitboards[OCCUPANCY].getData());
     }
 
 
+    // full zobrist key from scratch, init() uses it and it is handy for checking pushMove
+    uint64_t computeHash() const;
+    // pawns only, what pawnHash should be
+    uint64_t computePawnHash() const;
+    // same for the piece-square sums
+    PsqScore computePsq() const;
+
+    // fills a caller owned list with every legal move, nothing is allocated
+    void generateAllMoves(MoveList& moves);
+    // convenience copy for callers outside the search
     std::vector<BitMove> generateAllMoves();
+    // captures and promotions only, for quiescence. in check it is every evasion.
+    void generateCaptures(MoveList& moves);
+    // pieces of both colours attacking the square, sliders see through anything not in occupancy
+    uint64_t attackersTo(int square, uint64_t occupancy) const;
     void shutdown();
 private:
     const BitBoard generatePawnAttacks(const BitBoard pawns, char color);
     uint64_t generatePawnAttacksBitBoard(int square, char color);
     
-    void generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy);
-    void generateKingMoves(std::vector<BitMove>& moves, BitBoard kingBoard, uint64_t occupancy);
-    void generateRooksMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generateQueensMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
+    // check info for the side to move, filled by updateCheckInfo() once per generateAllMoves
+    void updateCheckInfo();
+    void generateEvasions(MoveList& moves);
+    void generatePieceMoves(MoveList& moves, uint64_t evasionMask);
+    void generateCastles(MoveList& moves);
+    void generateEnPassant(MoveList& moves, uint64_t evasionMask);
+
+    void generateKnightMoves(MoveList& moves, BitBoard knightBoard, uint64_t targets);
+    void generateKingMoves(MoveList& moves, BitBoard kingBoard, uint64_t targets);
+    void generateRooksMoves(MoveList& moves, BitBoard rookBoard, uint64_t occupancy, uint64_t targets);
+    void generateQueensMoves(MoveList& moves, BitBoard queenBoard, uint64_t occupancy, uint64_t targets);
+
+    void generateBishopMoves(MoveList& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t targets);
+    void generatePawnMoveList(MoveList& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color, uint64_t evasionMask);
+    void addPawnBitboardMovesToList(MoveList& moves, const BitBoard bitboard, const int shift, unsigned char flags = 0);
+    void addPromotionsToList(MoveList& moves, const BitBoard bitboard, const int shift, unsigned char flags = 0);
+    // IsCapture when an enemy piece stands on the square
+    unsigned char captureFlag(int square) const;
+    // restricts a pinned piece to the line through its king
+    uint64_t pinMask(int square) const;
+    bool isSquareAttacked(int square, char attackerColor, uint64_t occupancy) const;
+    void rebuildBitboards();
 
-    void generateBishopMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color);
-    void addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift);
-    bool isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]);
-    void filterOutIllegalMoves(std::vector<BitMove>& moves);
+    std::vector<UndoRecord> _undo;   // [0, stackPtr) are the moves made, the rest is spare room
 
+    int _kingSquare = 0;
+    uint64_t _checkers = 0;   // enemy pieces giving check
+    uint64_t _pinned = 0;     // our pieces that may only move along the line to our king
 };
@@ -0,0 +1,246 @@
+#include "MagicBitboards.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(CHESS_SLIDERS_RUNTIME)
+#include <immintrin.h>
+#endif
+
+uint64_t KnightAttacks[64];
+uint64_t KingAttacks[64];
+SliderMagic RookMagics[64];
+SliderMagic BishopMagics[64];
+
+#if defined(CHESS_SLIDERS_RUNTIME)
+bool g_sliderUsePext = false;
+#endif
+
+// every square's table is 2^popcount(mask) entries, these are the sums over the board
+static uint64_t _rookTable[0x19000];
+static uint64_t _bishopTable[0x1480];
+static SliderBackend _activeBackend = SliderBackend::Magic;
+
+static constexpr int rookDirections[4][2]   = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+static constexpr int bishopDirections[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+#if defined(CHESS_SLIDERS_RUNTIME)
+#if !defined(_MSC_VER)
+__attribute__((target("bmi2")))
+#endif
+uint64_t pextSliderIndex(uint64_t occupancy, uint64_t mask)
+{
+    return _pext_u64(occupancy, mask);
+}
+#endif
+
+static inline int popCount(uint64_t bb)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (int)__popcnt64(bb);
+#else
+    return __builtin_popcountll(bb);
+#endif
+}
+
+// software pext, only used while building the tables so the pext layout can be
+// filled on any cpu
+static uint64_t softwarePext(uint64_t occupancy, uint64_t mask)
+{
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask; bit <<= 1) {
+        if (occupancy & mask & (~mask + 1)) {
+            result |= bit;
+        }
+        mask &= mask - 1;
+    }
+    return result;
+}
+
+// xorshift64* with a fixed seed, so the magics found are the same on every run
+class MagicRandom
+{
+public:
+    MagicRandom(uint64_t seed) : _state(seed) { }
+
+    uint64_t next()
+    {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 2685821657736338717ULL;
+    }
+    // magics with few set bits make better hash multipliers
+    uint64_t sparse() { return next() & next() & next(); }
+
+private:
+    uint64_t _state;
+};
+
+static uint64_t slidingAttacks(const int (&directions)[4][2], int square, uint64_t occupancy)
+{
+    uint64_t attacks = 0;
+    for (const auto& dir : directions) {
+        int file = square % 8 + dir[0];
+        int rank = square / 8 + dir[1];
+        while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+            uint64_t bit = 1ULL << (rank * 8 + file);
+            attacks |= bit;
+            if (occupancy & bit) {
+                break;
+            }
+            file += dir[0];
+            rank += dir[1];
+        }
+    }
+    return attacks;
+}
+
+static uint64_t leaperAttacks(const int (&offsets)[8][2], int square)
+{
+    uint64_t attacks = 0;
+    for (const auto& offset : offsets) {
+        int file = square % 8 + offset[0];
+        int rank = square / 8 + offset[1];
+        if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+            attacks |= 1ULL << (rank * 8 + file);
+        }
+    }
+    return attacks;
+}
+
+static void initSliderTable(SliderMagic (&magics)[64], uint64_t* table, const int (&directions)[4][2], bool pextLayout)
+{
+    constexpr uint64_t rank1 = 0x00000000000000FFULL;
+    constexpr uint64_t rank8 = 0xFF00000000000000ULL;
+    constexpr uint64_t fileA = 0x0101010101010101ULL;
+    constexpr uint64_t fileH = 0x8080808080808080ULL;
+
+    // occupancy subsets and the matching attacks for the square being built
+    static uint64_t occupancies[4096];
+    static uint64_t reference[4096];
+    static int epoch[4096];
+    static int attempt = 0;
+
+    MagicRandom rng(0x2545F4914F6CDD1DULL);
+    uint64_t* nextSlice = table;
+
+    for (int square = 0; square < 64; ++square) {
+        // edge squares never block anything beyond themselves, unless the piece is on that edge
+        uint64_t edges = ((rank1 | rank8) & ~(rank1 << (8 * (square / 8)))) |
+                         ((fileA | fileH) & ~(fileA << (square % 8)));
+
+        SliderMagic& m = magics[square];
+        m.mask = slidingAttacks(directions, square, 0) & ~edges;
+        m.shift = 64 - popCount(m.mask);
+        m.attacks = nextSlice;
+        m.magic = 0;
+
+        // carry-rippler walk over every subset of the mask
+        int size = 0;
+        uint64_t subset = 0;
+        do {
+            occupancies[size] = subset;
+            reference[size] = slidingAttacks(directions, square, subset);
+            if (pextLayout) {
+                m.attacks[softwarePext(subset, m.mask)] = reference[size];
+            }
+            size++;
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+
+        nextSlice += size;
+        if (pextLayout) {
+            continue;
+        }
+
+        // find a magic that maps every subset to a slot without destructive collisions
+        for (int i = 0; i < size; ) {
+            do {
+                m.magic = rng.sparse();
+            } while (popCount((m.magic * m.mask) >> 56) < 6);
+
+            ++attempt;
+            for (i = 0; i < size; ++i) {
+                unsigned index = (unsigned)(((occupancies[i] & m.mask) * m.magic) >> m.shift);
+                if (epoch[index] < attempt) {
+                    epoch[index] = attempt;
+                    m.attacks[index] = reference[i];
+                } else if (m.attacks[index] != reference[i]) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool sliderBackendSupported(SliderBackend backend)
+{
+    switch (backend) {
+        case SliderBackend::Auto:
+        case SliderBackend::Magic:
+#if defined(CHESS_SLIDERS_PEXT)
+            // a pext-only build has no magic path compiled in
+            return backend == SliderBackend::Auto;
+#else
+            return true;
+#endif
+        case SliderBackend::Pext:
+#if defined(CHESS_SLIDERS_PEXT)
+            return true;
+#elif defined(CHESS_SLIDERS_RUNTIME) && defined(_MSC_VER)
+            int info[4];
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 8)) != 0;
+#elif defined(CHESS_SLIDERS_RUNTIME)
+            return __builtin_cpu_supports("bmi2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+SliderBackend activeSliderBackend()
+{
+    return _activeBackend;
+}
+
+const char* sliderBackendName(SliderBackend backend)
+{
+    switch (backend) {
+        case SliderBackend::Auto:  return "auto";
+        case SliderBackend::Magic: return "magic";
+        case SliderBackend::Pext:  return "pext";
+    }
+    return "unknown";
+}
+
+void initMagicBitboards(SliderBackend backend)
+{
+    static constexpr int knightOffsets[8][2] = { { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 } };
+    static constexpr int kingOffsets[8][2]   = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+
+    for (int square = 0; square < 64; ++square) {
+        KnightAttacks[square] = leaperAttacks(knightOffsets, square);
+        KingAttacks[square] = leaperAttacks(kingOffsets, square);
+    }
+
+    if (backend == SliderBackend::Auto || !sliderBackendSupported(backend)) {
+        backend = sliderBackendSupported(SliderBackend::Pext) ? SliderBackend::Pext : SliderBackend::Magic;
+    }
+
+    bool pextLayout = (backend == SliderBackend::Pext);
+    initSliderTable(RookMagics, _rookTable, rookDirections, pextLayout);
+    initSliderTable(BishopMagics, _bishopTable, bishopDirections, pextLayout);
+
+#if defined(CHESS_SLIDERS_RUNTIME)
+    g_sliderUsePext = pextLayout;
+#endif
+    _activeBackend = backend;
+}
+
+void cleanupMagicBitboards()
+{
+    // the tables live in static storage so there is nothing to free, and they
+    // stay valid for any GameState that is still searching
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+//
+// sliding piece attack lookups
+//
+// two backends share the same tables and only differ in how the occupancy is
+// turned into a table index:
+//  - Magic: fancy magic multiply + shift, portable to any 64-bit cpu
+//  - Pext:  BMI2 parallel bit extract, one instruction on Intel Haswell+ / AMD Zen3+
+//
+// the backend is chosen at build time with CHESS_SLIDER_BACKEND (see CMakeLists.txt):
+//  - "magic":   nothing defined, only the magic path is compiled in
+//  - "pext":    CHESS_SLIDERS_PEXT is defined and the code is built with -mbmi2
+//  - "runtime": CHESS_SLIDERS_RUNTIME is defined, both paths are compiled in and
+//               initMagicBitboards() picks pext if the cpu has BMI2. the pext index
+//               is an out of line call in this mode, so prefer a native build when
+//               the binary doesn't have to run on other machines.
+//  - "auto":    probes the build machine and becomes "pext" or "magic"
+//
+#if defined(CHESS_SLIDERS_PEXT)
+#include <immintrin.h>
+#elif defined(CHESS_SLIDERS_RUNTIME) && !(defined(__x86_64__) || defined(_M_X64))
+#undef CHESS_SLIDERS_RUNTIME
+#endif
+
+enum class SliderBackend
+{
+    Auto,   // best backend the cpu supports
+    Magic,
+    Pext
+};
+
+struct SliderMagic
+{
+    uint64_t    mask;       // relevant occupancy bits, edges removed
+    uint64_t    magic;      // unused by the pext backend
+    uint64_t*   attacks;    // this square's slice of the shared attack table
+    unsigned    shift;      // 64 - popcount(mask)
+};
+
+extern uint64_t KnightAttacks[64];
+extern uint64_t KingAttacks[64];
+extern SliderMagic RookMagics[64];
+extern SliderMagic BishopMagics[64];
+
+#if defined(CHESS_SLIDERS_RUNTIME)
+extern bool g_sliderUsePext;
+uint64_t pextSliderIndex(uint64_t occupancy, uint64_t mask);
+#endif
+
+// fills the leaper tables and builds the slider tables for the requested backend.
+// can be called again with a different backend, the tables are rebuilt in place.
+void initMagicBitboards(SliderBackend backend = SliderBackend::Auto);
+void cleanupMagicBitboards();
+
+// true if the running cpu (and this build) can use the pext backend
+bool sliderBackendSupported(SliderBackend backend);
+SliderBackend activeSliderBackend();
+const char* sliderBackendName(SliderBackend backend);
+
+inline uint64_t sliderAttacks(const SliderMagic& m, uint64_t occupancy)
+{
+#if defined(CHESS_SLIDERS_PEXT)
+    return m.attacks[_pext_u64(occupancy, m.mask)];
+#elif defined(CHESS_SLIDERS_RUNTIME)
+    if (g_sliderUsePext) {
+        return m.attacks[pextSliderIndex(occupancy, m.mask)];
+    }
+    return m.attacks[((occupancy & m.mask) * m.magic) >> m.shift];
+#else
+    return m.attacks[((occupancy & m.mask) * m.magic) >> m.shift];
+#endif
+}
+
+inline uint64_t getBishopAttacks(int square, uint64_t occupancy)
+{
+    return sliderAttacks(BishopMagics[square], occupancy);
+}
+
+inline uint64_t getRookAttacks(int square, uint64_t occupancy)
+{
+    return sliderAttacks(RookMagics[square], occupancy);
+}
+
+inline uint64_t getQueenAttacks(int square, uint64_t occupancy)
+{
+    return getBishopAttacks(square, occupancy) | getRookAttacks(square, occupancy);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//
+// read-only memory mapping of a whole file, unmapped when it goes away.
+// the pages are shared with the page cache, so big tables cost nothing until touched.
+//
+class MappedFile
+{
+public:
+    MappedFile() { }
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file can't be opened or is empty
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return _data != nullptr; }
+    const void* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    void* _data = nullptr;
+    size_t _size = 0;
+};
@@ -0,0 +1,426 @@
+#include "Nnue.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define NNUE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace nnue {
+
+//
+// kernels: accumulator column add/sub, clipping the accumulators to bytes, and the
+// int8 affine layers. the vector versions are built with target attributes so the rest
+// of the program doesn't need -mavx2, and the scalar one is the reference.
+//
+struct Kernels
+{
+    void (*addColumn)(int16_t* acc, const int16_t* column);
+    void (*subColumn)(int16_t* acc, const int16_t* column);
+    void (*clip)(const int16_t* in, uint8_t* out);
+    int32_t (*dot)(const uint8_t* in, const int8_t* weights, int size);
+};
+
+static void addColumnScalar(int16_t* acc, const int16_t* column)
+{
+    for (int i = 0; i < L1; ++i) acc[i] += column[i];
+}
+
+static void subColumnScalar(int16_t* acc, const int16_t* column)
+{
+    for (int i = 0; i < L1; ++i) acc[i] -= column[i];
+}
+
+static void clipScalar(const int16_t* in, uint8_t* out)
+{
+    for (int i = 0; i < L1; ++i) {
+        out[i] = (uint8_t)(in[i] < 0 ? 0 : in[i] > 127 ? 127 : in[i]);
+    }
+}
+
+static int32_t dotScalar(const uint8_t* in, const int8_t* weights, int size)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < size; ++i) sum += in[i] * weights[i];
+    return sum;
+}
+
+#if defined(NNUE_X86_KERNELS)
+__attribute__((target("sse4.1")))
+static void addColumnSse41(int16_t* acc, const int16_t* column)
+{
+    for (int i = 0; i < L1; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(column + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_add_epi16(a, c));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void subColumnSse41(int16_t* acc, const int16_t* column)
+{
+    for (int i = 0; i < L1; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(column + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_sub_epi16(a, c));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void clipSse41(const int16_t* in, uint8_t* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < L1; i += 16) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(in + i + 8));
+        // saturating pack to [-128, 127], then drop the negatives
+        _mm_storeu_si128((__m128i*)(out + i), _mm_max_epi8(_mm_packs_epi16(lo, hi), zero));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static int32_t dotSse41(const uint8_t* in, const int8_t* weights, int size)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+        // inputs are at most 127 so the pairwise int16 sums can't saturate
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+static void addColumnAvx2(int16_t* acc, const int16_t* column)
+{
+    for (int i = 0; i < L1; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(column + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_add_epi16(a, c));
+    }
+}
+
+__attribute__((target("avx2")))
+static void subColumnAvx2(int16_t* acc, const int16_t* column)
+{
+    for (int i = 0; i < L1; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(column + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_sub_epi16(a, c));
+    }
+}
+
+__attribute__((target("avx2")))
+static void clipAvx2(const int16_t* in, uint8_t* out)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < L1; i += 32) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(in + i + 16));
+        // the pack works per 128 bit lane, the permute puts the bytes back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_max_epi8(packed, zero));
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t dotAvx2(const uint8_t* in, const int8_t* weights, int size)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+static const Kernels ScalarKernels = { addColumnScalar, subColumnScalar, clipScalar, dotScalar };
+#if defined(NNUE_X86_KERNELS)
+static const Kernels Sse41Kernels = { addColumnSse41, subColumnSse41, clipSse41, dotSse41 };
+static const Kernels Avx2Kernels = { addColumnAvx2, subColumnAvx2, clipAvx2, dotAvx2 };
+#endif
+
+static const Kernels& kernelsFor(Kernel kernel)
+{
+#if defined(NNUE_X86_KERNELS)
+    if (kernel == Kernel::Avx2) return Avx2Kernels;
+    if (kernel == Kernel::Sse41) return Sse41Kernels;
+#endif
+    return ScalarKernels;
+}
+
+bool kernelSupported(Kernel kernel)
+{
+    switch (kernel) {
+        case Kernel::Auto:
+        case Kernel::Scalar:
+            return true;
+#if defined(NNUE_X86_KERNELS)
+        case Kernel::Sse41:
+            return __builtin_cpu_supports("sse4.1");
+        case Kernel::Avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case Kernel::Sse41:
+        case Kernel::Avx2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* kernelName(Kernel kernel)
+{
+    switch (kernel) {
+        case Kernel::Auto:   return "auto";
+        case Kernel::Scalar: return "scalar";
+        case Kernel::Sse41:  return "sse4.1";
+        case Kernel::Avx2:   return "avx2";
+    }
+    return "unknown";
+}
+
+int featureIndex(int perspective, int kingSquare, int board, int square)
+{
+    // black sees the board upside down so both sides share one set of weights
+    const int flip = (perspective == 0) ? 0 : 56;
+    const int pieceColor = (board < WHITE_ALL_PIECES) ? 0 : 1;
+    const int pieceType = board % 7;    // pawn .. queen, kings never get here
+    const int piece = pieceType * 2 + (pieceColor == perspective ? 0 : 1);
+    return (kingSquare ^ flip) * PieceInputs + piece * 64 + (square ^ flip);
+}
+
+static inline bool isFeaturePiece(int board)
+{
+    return board != EMPTY_SQUARES && board % 7 != WHITE_KING;
+}
+
+Network::Network() { }
+
+Network::~Network()
+{
+    unload();
+}
+
+void Network::unload()
+{
+    _file.close();
+}
+
+bool Network::load(const std::string& path, Kernel kernel)
+{
+    if (!_file.open(path) || _file.size() != FileSize) {
+        _file.close();
+        return false;
+    }
+
+    const FileHeader* header = (const FileHeader*)_file.data();
+    if (std::memcmp(header->magic, "CHESSNN1", 8) != 0 || header->inputs != (uint32_t)Inputs ||
+        header->l1 != (uint32_t)L1 || header->l2 != (uint32_t)L2 || header->l3 != (uint32_t)L3) {
+        unload();
+        return false;
+    }
+
+    const char* cursor = (const char*)_file.data() + sizeof(FileHeader);
+    auto take = [&cursor](size_t bytes) {
+        const char* at = cursor;
+        cursor += bytes;
+        return at;
+    };
+    _ftBias = (const int16_t*)take(sizeof(int16_t) * L1);
+    _ftWeights = (const int16_t*)take(sizeof(int16_t) * (size_t)Inputs * L1);
+    _l1Bias = (const int32_t*)take(sizeof(int32_t) * L2);
+    _l1Weights = (const int8_t*)take(sizeof(int8_t) * L2 * 2 * L1);
+    _l2Bias = (const int32_t*)take(sizeof(int32_t) * L3);
+    _l2Weights = (const int8_t*)take(sizeof(int8_t) * L3 * L2);
+    _outBias = (const int32_t*)take(sizeof(int32_t));
+    _outWeights = (const int8_t*)take(sizeof(int8_t) * L3);
+
+    return setKernel(kernel);
+}
+
+bool Network::setKernel(Kernel kernel)
+{
+    if (kernel == Kernel::Auto) {
+        kernel = kernelSupported(Kernel::Avx2) ? Kernel::Avx2 :
+                 kernelSupported(Kernel::Sse41) ? Kernel::Sse41 : Kernel::Scalar;
+    }
+    if (!kernelSupported(kernel)) {
+        return false;
+    }
+    _kernel = kernel;
+    return true;
+}
+
+void Network::refresh(const GameStateData& position, int perspective, int16_t* out) const
+{
+    const Kernels& k = kernelsFor(_kernel);
+    std::memcpy(out, _ftBias, sizeof(int16_t) * L1);
+    const int kingSquare = position._bitboards[perspective == 0 ? WHITE_KING : BLACK_KING].firstBit();
+    for (int square = 0; square < 64; ++square) {
+        const int board = bitboardForPiece[(unsigned char)position.state[square]];
+        if (isFeaturePiece(board)) {
+            k.addColumn(out, _ftWeights + (size_t)featureIndex(perspective, kingSquare, board, square) * L1);
+        }
+    }
+}
+
+void Network::update(const int16_t* in, int16_t* out, const int* added, int addedCount,
+                     const int* removed, int removedCount) const
+{
+    const Kernels& k = kernelsFor(_kernel);
+    if (in != out) {
+        std::memcpy(out, in, sizeof(int16_t) * L1);
+    }
+    for (int i = 0; i < removedCount; ++i) {
+        k.subColumn(out, _ftWeights + (size_t)removed[i] * L1);
+    }
+    for (int i = 0; i < addedCount; ++i) {
+        k.addColumn(out, _ftWeights + (size_t)added[i] * L1);
+    }
+}
+
+int Network::propagate(const Accumulator& accumulator, char sideToMove) const
+{
+    const Kernels& k = kernelsFor(_kernel);
+    const int us = (sideToMove == WHITE) ? 0 : 1;
+
+    alignas(64) uint8_t input[2 * L1];
+    k.clip(accumulator.values[us], input);
+    k.clip(accumulator.values[us ^ 1], input + L1);
+
+    alignas(64) uint8_t hidden1[L2];
+    for (int i = 0; i < L2; ++i) {
+        int32_t sum = (_l1Bias[i] + k.dot(input, _l1Weights + i * 2 * L1, 2 * L1)) >> WeightShift;
+        hidden1[i] = (uint8_t)(sum < 0 ? 0 : sum > 127 ? 127 : sum);
+    }
+
+    alignas(64) uint8_t hidden2[L3];
+    for (int i = 0; i < L3; ++i) {
+        int32_t sum = (_l2Bias[i] + k.dot(hidden1, _l2Weights + i * L2, L2)) >> WeightShift;
+        hidden2[i] = (uint8_t)(sum < 0 ? 0 : sum > 127 ? 127 : sum);
+    }
+
+    return (*_outBias + k.dot(hidden2, _outWeights, L3)) / OutputScale;
+}
+
+Evaluator::Evaluator(const Network& network) : _network(network), _stack(UNDO_RESERVE + 1)
+{
+}
+
+void Evaluator::applyMove(const UndoRecord& undo, int perspective, int kingSquare, const int16_t* in, int16_t* out) const
+{
+    // a move takes at most two pieces off and puts two on (castling), kings aren't features
+    int added[2];
+    int removed[2];
+    int addedCount = 0;
+    int removedCount = 0;
+    auto add = [&](int board, int square) {
+        if (isFeaturePiece(board)) {
+            added[addedCount++] = featureIndex(perspective, kingSquare, board, square);
+        }
+    };
+    auto remove = [&](int board, int square) {
+        if (isFeaturePiece(board)) {
+            removed[removedCount++] = featureIndex(perspective, kingSquare, board, square);
+        }
+    };
+
+    const BitMove& move = undo.move;
+    const int moverBoard = bitboardForPiece[(unsigned char)undo.moved];
+    remove(moverBoard, move.from);
+    if (move.flags & IsPromotion) {
+        add(moverBoard + (move.promotionPiece() - Pawn), move.to);
+    } else {
+        add(moverBoard, move.to);
+    }
+    if (undo.captured != '0') {
+        const int captureSquare = (move.flags & EnPassant) ? ((undo.moved == 'P') ? move.to - 8 : move.to + 8) : move.to;
+        remove(bitboardForPiece[(unsigned char)undo.captured], captureSquare);
+    }
+    if (move.flags & KingSideCastle) {
+        const int rookBoard = moverBoard + (WHITE_ROOKS - WHITE_KING);
+        remove(rookBoard, move.to + 1);
+        add(rookBoard, move.to - 1);
+    } else if (move.flags & QueenSideCastle) {
+        const int rookBoard = moverBoard + (WHITE_ROOKS - WHITE_KING);
+        remove(rookBoard, move.to - 2);
+        add(rookBoard, move.to + 1);
+    }
+    _network.update(in, out, added, addedCount, removed, removedCount);
+}
+
+int Evaluator::evaluate(const GameState& gs)
+{
+    const int top = gs.stackPtr;
+    if (top >= (int)_stack.size()) {
+        _stack.resize(top * 2);
+    }
+
+    // nearest position on the current line whose accumulator is still valid. a slot is
+    // reused by every line through that ply, the key says whether it is this one.
+    int base = top;
+    while (base >= 0 && !(_stack[base].computed && _stack[base].key == gs.hashAt(base))) {
+        base--;
+    }
+
+    if (base < 0) {
+        _network.refresh(gs, 0, _stack[top].values[0]);
+        _network.refresh(gs, 1, _stack[top].values[1]);
+        _stack[top].key = gs.hash;
+        _stack[top].computed = true;
+        return _network.propagate(_stack[top], gs.color);
+    }
+
+    // every feature of a side depends on its king square. only the current board is at hand,
+    // so a king move in between means that side is rebuilt from it rather than replayed.
+    bool kingMoved[2] = { false, false };
+    for (int ply = base; ply < top; ++ply) {
+        const char moved = gs.undoAt(ply).moved;
+        kingMoved[0] |= (moved == 'K');
+        kingMoved[1] |= (moved == 'k');
+    }
+    const int kingSquare[2] = { gs._bitboards[WHITE_KING].firstBit(), gs._bitboards[BLACK_KING].firstBit() };
+
+    if (!kingMoved[0] && !kingMoved[1]) {
+        for (int ply = base + 1; ply <= top; ++ply) {
+            const UndoRecord& undo = gs.undoAt(ply - 1);
+            for (int perspective = 0; perspective < 2; ++perspective) {
+                applyMove(undo, perspective, kingSquare[perspective], _stack[ply - 1].values[perspective],
+                          _stack[ply].values[perspective]);
+            }
+            _stack[ply].key = gs.hashAt(ply);
+            _stack[ply].computed = true;
+        }
+    } else {
+        // straight to the top, the plies in between are left for whoever needs them
+        Accumulator& to = _stack[top];
+        for (int perspective = 0; perspective < 2; ++perspective) {
+            if (kingMoved[perspective]) {
+                _network.refresh(gs, perspective, to.values[perspective]);
+                continue;
+            }
+            const int16_t* in = _stack[base].values[perspective];
+            for (int ply = base; ply < top; ++ply) {
+                applyMove(gs.undoAt(ply), perspective, kingSquare[perspective], in, to.values[perspective]);
+                in = to.values[perspective];
+            }
+        }
+        to.key = gs.hash;
+        to.computed = true;
+    }
+
+    return _network.propagate(_stack[top], gs.color);
+}
+
+} // namespace nnue
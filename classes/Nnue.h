@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GameState.h"
+#include "MappedFile.h"
+
+//
+// efficiently updatable neural network evaluation, optional alongside the piece-square eval
+//
+// inputs are HalfKP: for each side, its king square times every non-king piece on every
+// square (64 * 10 * 64 = 40960 features, a handful active). the first layer is a sum of
+// int16 weight columns kept in an accumulator per side, so a move only adds and subtracts
+// the columns of the pieces it changed. after that:
+//
+//   accumulators (2 x 256, side to move first) -> clipped relu -> int8 affine 512->32
+//   -> clipped relu -> int8 affine 32->32 -> clipped relu -> int8 affine 32->1
+//
+// the kernels come in scalar, SSE4.1 and AVX2 versions, compiled side by side and picked
+// when the network is loaded by what the cpu supports. weights are memory mapped from a
+// file in the layout of NnueFileHeader, nothing is copied.
+//
+
+namespace nnue {
+
+constexpr int PieceInputs = 10 * 64;            // piece type x colour x square, kings excluded
+constexpr int Inputs = 64 * PieceInputs;        // times the king square
+constexpr int L1 = 256;                         // accumulator width per side
+constexpr int L2 = 32;
+constexpr int L3 = 32;
+constexpr int WeightShift = 6;                  // hidden layer outputs are sums / 64
+constexpr int OutputScale = 16;                 // net output units per centipawn
+
+enum class Kernel
+{
+    Auto,   // best one the cpu supports
+    Scalar,
+    Sse41,
+    Avx2
+};
+
+bool kernelSupported(Kernel kernel);
+const char* kernelName(Kernel kernel);
+
+//
+// file layout, little endian, the header is followed directly by
+//   int16 ftBias[L1], int16 ftWeights[Inputs][L1],
+//   int32 l1Bias[L2], int8 l1Weights[L2][2 * L1],
+//   int32 l2Bias[L3], int8 l2Weights[L3][L2],
+//   int32 outBias,    int8 outWeights[L3]
+//
+struct FileHeader
+{
+    char magic[8];          // "CHESSNN1"
+    uint32_t inputs;
+    uint32_t l1;
+    uint32_t l2;
+    uint32_t l3;
+    uint32_t reserved[10];  // pads the header to 64 bytes
+};
+static_assert(sizeof(FileHeader) == 64, "the weights start 64 bytes in");
+
+constexpr size_t FileSize = sizeof(FileHeader) +
+    sizeof(int16_t) * (L1 + (size_t)Inputs * L1) +
+    sizeof(int32_t) * L2 + sizeof(int8_t) * L2 * 2 * L1 +
+    sizeof(int32_t) * L3 + sizeof(int8_t) * L3 * L2 +
+    sizeof(int32_t) + sizeof(int8_t) * L3;
+
+// feature of the piece in the given AllBitBoards slot on square, seen from one side
+int featureIndex(int perspective, int kingSquare, int board, int square);
+
+struct alignas(64) Accumulator
+{
+    int16_t values[2][L1];  // [0] from white's side, [1] from black's
+    uint64_t key = 0;       // hash of the position it was computed for
+    bool computed = false;
+};
+
+class Network
+{
+public:
+    Network();
+    ~Network();
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+
+    // maps the file read-only, false if it can't be opened or has the wrong shape
+    bool load(const std::string& path, Kernel kernel = Kernel::Auto);
+    void unload();
+    bool loaded() const { return _file.isOpen(); }
+
+    // switch kernels on a loaded network, every kernel gives the same result
+    bool setKernel(Kernel kernel);
+    Kernel kernel() const { return _kernel; }
+
+    // one side's accumulator from scratch
+    void refresh(const GameStateData& position, int perspective, int16_t* out) const;
+    // out = in + the added feature columns - the removed ones
+    void update(const int16_t* in, int16_t* out, const int* added, int addedCount,
+                const int* removed, int removedCount) const;
+    // everything after the accumulators, centipawns for the side to move
+    int propagate(const Accumulator& accumulator, char sideToMove) const;
+
+private:
+    MappedFile _file;
+    Kernel _kernel = Kernel::Scalar;
+
+    const int16_t* _ftBias = nullptr;
+    const int16_t* _ftWeights = nullptr;
+    const int32_t* _l1Bias = nullptr;
+    const int8_t* _l1Weights = nullptr;
+    const int32_t* _l2Bias = nullptr;
+    const int8_t* _l2Weights = nullptr;
+    const int32_t* _outBias = nullptr;
+    const int8_t* _outWeights = nullptr;
+};
+
+//
+// accumulators for one search thread, one per ply of the GameState's undo stack.
+// the accumulator of a position is built from its parent's with the pieces named in the
+// undo record of the move between them, so make/unmake costs nothing extra and only
+// positions that get evaluated are updated.
+//
+class Evaluator
+{
+public:
+    explicit Evaluator(const Network& network);
+
+    // centipawns for the side to move
+    int evaluate(const GameState& gs);
+
+private:
+    // out = in with the move of undo applied, for one side whose king stays on kingSquare
+    void applyMove(const UndoRecord& undo, int perspective, int kingSquare, const int16_t* in, int16_t* out) const;
+
+    const Network& _network;
+    std::vector<Accumulator> _stack;    // grows with the undo stack, the current position sits at stackPtr
+};
+
+} // namespace nnue
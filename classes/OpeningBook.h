@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "GameState.h"
+#include "MappedFile.h"
+
+//
+// opening book in the Polyglot .bin layout
+//
+// the file is a sorted array of 16 byte big-endian entries, memory mapped and binary
+// searched by position key, so a lookup is O(log n) and nothing is read into the heap.
+// entries with the same key are the book moves for that position, each with a weight.
+//
+// keys are the Polyglot ones (piece/square, castling, en passant file when a capture
+// is possible, white to move, from the published Random64 table), so books made by
+// tools/book_builder and by other Polyglot tools both work here.
+//
+namespace book {
+
+struct Entry
+{
+    uint64_t key = 0;
+    uint16_t move = 0;      // to file, to row, from file, from row, promotion: 3 bits each
+    uint16_t weight = 0;
+    uint32_t learn = 0;
+};
+constexpr size_t EntrySize = 16;
+
+// polyglot key of the position
+uint64_t positionKey(const GameStateData& position);
+
+// between BitMove and the polyglot move encoding, where castling is king takes own rook
+uint16_t encodeMove(const BitMove& move);
+// the legal move the encoding stands for, a default BitMove if there is none
+BitMove decodeMove(GameState& gs, uint16_t move);
+
+// big-endian entry i of a raw book, and the other way round
+Entry readEntry(const unsigned char* bytes);
+void writeEntry(const Entry& entry, unsigned char* bytes);
+
+class OpeningBook
+{
+public:
+    bool open(const std::string& path);
+    void close() { _file.close(); _count = 0; }
+    bool isOpen() const { return _file.isOpen(); }
+    size_t size() const { return _count; }
+
+    // entries for key, first is the index of the first one. returns how many
+    size_t find(uint64_t key, size_t& first) const;
+    Entry entry(size_t index) const;
+
+    // a book move for the position picked at random by weight, false when out of book.
+    // random is any uniformly distributed number, the caller owns the generator.
+    bool pickMove(GameState& gs, uint64_t random, BitMove& move) const;
+
+private:
+    MappedFile _file;
+    size_t _count = 0;
+};
+
+} // namespace book
@@ -0,0 +1,78 @@
+#include "PawnTable.h"
+
+static inline int popCount(uint64_t bb)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (int)__popcnt64(bb);
+#else
+    return __builtin_popcountll(bb);
+#endif
+}
+
+// penalties per pawn, midgame then endgame
+static constexpr int DoubledMidgame = -11;
+static constexpr int DoubledEndgame = -56;
+static constexpr int IsolatedMidgame = -5;
+static constexpr int IsolatedEndgame = -15;
+// passed pawn bonus by rank counted from the pawn's own side, ranks 2 to 7
+static constexpr int PassedMidgame[8] = { 0, 5, 10, 15, 30, 55, 90, 0 };
+static constexpr int PassedEndgame[8] = { 0, 10, 20, 35, 60, 100, 150, 0 };
+
+// one side's terms. pawns move north for white, the board is flipped for black
+template <bool White>
+static void evaluateSide(uint64_t ours, uint64_t theirs, int& midgame, int& endgame, uint64_t& passed)
+{
+    // squares the enemy pawns can still stop or capture a pawn on: everything in front
+    // of them on their own and the neighbouring files
+    const uint64_t theirFront = White ? southFill(theirs >> 8) : northFill(theirs << 8);
+    const uint64_t stoppers = theirFront | adjacentFiles(theirFront);
+    passed = ours & ~stoppers;
+
+    // every pawn with another of ours behind it on the file counts once
+    const uint64_t behind = White ? northFill(ours << 8) : southFill(ours >> 8);
+    const int doubled = popCount(ours & behind);
+    const int isolated = popCount(ours & ~adjacentFiles(fileFill(ours)));
+
+    midgame = doubled * DoubledMidgame + isolated * IsolatedMidgame;
+    endgame = doubled * DoubledEndgame + isolated * IsolatedEndgame;
+    BitBoard(passed).forEachBit([&](int square) {
+        const int rank = White ? square / 8 : 7 - square / 8;
+        midgame += PassedMidgame[rank];
+        endgame += PassedEndgame[rank];
+    });
+}
+
+PawnEntry evaluatePawns(uint64_t whitePawns, uint64_t blackPawns)
+{
+    int whiteMidgame, whiteEndgame, blackMidgame, blackEndgame;
+    PawnEntry entry;
+    evaluateSide<true>(whitePawns, blackPawns, whiteMidgame, whiteEndgame, entry.passed[0]);
+    evaluateSide<false>(blackPawns, whitePawns, blackMidgame, blackEndgame, entry.passed[1]);
+    entry.midgame = (int16_t)(whiteMidgame - blackMidgame);
+    entry.endgame = (int16_t)(whiteEndgame - blackEndgame);
+    return entry;
+}
+
+PawnTable::PawnTable(size_t entries)
+{
+    size_t count = 1;
+    while (count * 2 <= entries) {
+        count *= 2;
+    }
+    // the empty key is zero and so is the score of no pawns, so a fresh table is valid
+    _entries.reset(new PawnEntry[count]);
+    _mask = count - 1;
+}
+
+const PawnEntry& PawnTable::probe(const GameStateData& position)
+{
+    PawnEntry& entry = _entries[position.pawnHash & _mask];
+    if (entry.key == position.pawnHash) {
+        _hits++;
+        return entry;
+    }
+    _misses++;
+    entry = evaluatePawns(position._bitboards[WHITE_PAWNS].getData(), position._bitboards[BLACK_PAWNS].getData());
+    entry.key = position.pawnHash;
+    return entry;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "GameState.h"
+
+//
+// pawn structure evaluation and its hash table
+//
+// doubled, isolated and passed pawns only depend on where the pawns are, and the pawns
+// rarely move compared to everything else, so the terms are cached under
+// GameStateData::pawnHash. one table per search thread, nothing is shared.
+//
+
+// every square north (towards rank 8) of a set square, the square itself included
+inline constexpr uint64_t northFill(uint64_t b)
+{
+    b |= b << 8;
+    b |= b << 16;
+    b |= b << 32;
+    return b;
+}
+
+inline constexpr uint64_t southFill(uint64_t b)
+{
+    b |= b >> 8;
+    b |= b >> 16;
+    b |= b >> 32;
+    return b;
+}
+
+// whole files that hold at least one set square
+inline constexpr uint64_t fileFill(uint64_t b)
+{
+    return northFill(b) | southFill(b);
+}
+
+// the squares one file to each side
+inline constexpr uint64_t adjacentFiles(uint64_t b)
+{
+    return ((b << 1) & NotAFile) | ((b >> 1) & NotHFile);
+}
+
+struct PawnEntry
+{
+    uint64_t key = 0;
+    int16_t midgame = 0;        // from white's side
+    int16_t endgame = 0;
+    uint64_t passed[2] = {};    // [0] white's passed pawns, [1] black's
+
+    // blended the same way as PsqScore, phase is GameStateData::psq.phase
+    int tapered(int phase) const {
+        const int weight = phase < PhaseMax ? phase : PhaseMax;
+        return (midgame * weight + endgame * (PhaseMax - weight)) / PhaseMax;
+    }
+};
+
+// the terms from scratch, what the table stores
+PawnEntry evaluatePawns(uint64_t whitePawns, uint64_t blackPawns);
+
+class PawnTable
+{
+public:
+    // entries is rounded down to a power of two
+    explicit PawnTable(size_t entries = 1 << 14);
+
+    // cached entry for the position's pawns, computed and stored on a miss
+    const PawnEntry& probe(const GameStateData& position);
+
+    uint64_t hits() const { return _hits; }
+    uint64_t misses() const { return _misses; }
+
+private:
+    std::unique_ptr<PawnEntry[]> _entries;
+    size_t _mask;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+};
@@ -0,0 +1,520 @@
+#include "Search.h"
+#include "Trace.h"
+#include "MagicBitboards.h"
+#include <algorithm>
+#include <utility>
+
+int evaluate(const GameState& gs)
+{
+    return gs.psq.tapered() * gs.color;
+}
+
+// middlegame material, indexed by ChessPiece. the king only has to outweigh everything else
+static constexpr int SeeValues[] = { 0, MidgameValue[Pawn], MidgameValue[Knight], MidgameValue[Bishop],
+                                     MidgameValue[Rook], MidgameValue[Queen], 20000 };
+// a capture that can't reach alpha even with this much positional gain is skipped
+static constexpr int DeltaMargin = 200;
+
+int staticExchange(const GameState& gs, const BitMove& move)
+{
+    const int to = move.to;
+    uint64_t occupancy = gs._bitboards[OCCUPANCY].getData() ^ (1ULL << move.from);
+    int victim = bitboardForPiece[(unsigned char)gs.state[to]] % 7 + Pawn;
+    if (move.flags & EnPassant) {
+        victim = Pawn;
+        occupancy ^= 1ULL << ((gs.color == WHITE) ? to - 8 : to + 8);
+    } else if (gs.state[to] == '0') {
+        victim = NoPiece;
+    }
+
+    const uint64_t diagonals = gs._bitboards[WHITE_BISHOPS].getData() | gs._bitboards[WHITE_QUEENS].getData() |
+                               gs._bitboards[BLACK_BISHOPS].getData() | gs._bitboards[BLACK_QUEENS].getData();
+    const uint64_t straights = gs._bitboards[WHITE_ROOKS].getData() | gs._bitboards[WHITE_QUEENS].getData() |
+                               gs._bitboards[BLACK_ROOKS].getData() | gs._bitboards[BLACK_QUEENS].getData();
+
+    // gain[d] is what the side making capture d is up if the sequence stopped there
+    int gain[32];
+    int d = 0;
+    gain[0] = SeeValues[victim];
+    int onSquare = move.piece;
+    if (move.flags & IsPromotion) {
+        onSquare = move.promotionPiece();
+        gain[0] += SeeValues[onSquare] - SeeValues[Pawn];
+    }
+
+    uint64_t attackers = gs.attackersTo(to, occupancy) & occupancy;
+    int side = (gs.color == WHITE) ? 1 : 0;   // 0 = white, 1 = black, to move next
+    while (d < 31) {
+        const int base = side ? BLACK_PAWNS : WHITE_PAWNS;
+        const uint64_t ours = attackers & gs._bitboards[base + (WHITE_ALL_PIECES - WHITE_PAWNS)].getData();
+        if (!ours) {
+            break;
+        }
+        // the cheapest attacker recaptures
+        int piece = Pawn;
+        uint64_t candidates = 0;
+        for (; piece <= King; ++piece) {
+            candidates = ours & gs._bitboards[base + piece - Pawn].getData();
+            if (candidates) {
+                break;
+            }
+        }
+
+        d++;
+        gain[d] = SeeValues[onSquare] - gain[d - 1];
+        // neither side can do better by carrying on
+        if (std::max(-gain[d - 1], gain[d]) < 0) {
+            break;
+        }
+        onSquare = piece;
+        occupancy ^= candidates & (0 - candidates);
+        // pieces lined up behind the one that just went are attackers now
+        if (piece == Pawn || piece == Bishop || piece == Queen) {
+            attackers |= getBishopAttacks(to, occupancy) & diagonals;
+        }
+        if (piece == Rook || piece == Queen) {
+            attackers |= getRookAttacks(to, occupancy) & straights;
+        }
+        attackers &= occupancy;
+        side ^= 1;
+    }
+
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+    return gain[0];
+}
+
+// mate scores are stored relative to the node that found them so the same entry
+// is correct no matter how far from the root the position is reached again
+static inline int scoreToTT(int score, int ply)
+{
+    if (score > MATE_BOUND) return score + ply;
+    if (score < -MATE_BOUND) return score - ply;
+    return score;
+}
+
+static inline int scoreFromTT(int score, int ply)
+{
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
+}
+
+// how often the clock is read, a power of two minus one
+static constexpr uint64_t TimeCheckMask = 2047;
+// time held back from the clock for move overhead
+static constexpr int ClockReserveMs = 50;
+
+bool Search::shouldStop()
+{
+    if (_stopped) {
+        return true;
+    }
+    if (_stopRequested.load(std::memory_order_relaxed) ||
+        (_sharedStop && _sharedStop->load(std::memory_order_relaxed)) ||
+        (_nodeLimit && _nodes >= _nodeLimit) ||
+        (_timed && (_nodes & TimeCheckMask) == 0 && Clock::now() >= _deadline)) {
+        _stopped = true;
+    }
+    return _stopped;
+}
+
+void Search::setNetwork(const nnue::Network* network)
+{
+    if (network && network->loaded()) {
+        _nnue = std::make_unique<nnue::Evaluator>(*network);
+    } else {
+        _nnue.reset();
+    }
+}
+
+int Search::staticEval(const GameState& gs)
+{
+    if (_nnue) {
+        return _nnue->evaluate(gs);
+    }
+    return evaluate(gs) + _pawnTable.probe(gs).tapered(gs.psq.phase) * gs.color;
+}
+
+// ordering scores, each bucket sits above everything after it
+static constexpr int HashMoveScore = 1 << 30;
+static constexpr int CaptureScore = 1 << 28;
+static constexpr int KillerScore = 1 << 27;
+// history is halved once any entry passes this so it stays below the killers
+static constexpr int HistoryMax = 1 << 20;
+
+static inline int pieceTypeAt(const GameState& gs, int square)
+{
+    // piece bitboards run pawn..king for each colour, seven apart
+    return bitboardForPiece[(unsigned char)gs.state[square]] % 7 + Pawn;
+}
+
+void Search::scoreMoves(const GameState& gs, const MoveList& moves, int* scores, uint16_t hashMove, int ply) const
+{
+    const int side = (gs.color == WHITE) ? 0 : 1;
+    for (int i = 0; i < moves.size(); ++i) {
+        const BitMove& move = moves[i];
+        if (hashMove && TranspositionTable::sameMove(hashMove, move)) {
+            scores[i] = HashMoveScore;
+        } else if (move.flags & IsCapture) {
+            // most valuable victim first, the cheaper attacker breaks ties
+            int victim = (move.flags & EnPassant) ? Pawn : pieceTypeAt(gs, move.to);
+            scores[i] = CaptureScore + victim * 8 - move.piece;
+        } else if (move.promotionPiece() == Queen) {
+            scores[i] = CaptureScore;
+        } else if (move == _killers[ply][0]) {
+            scores[i] = KillerScore + 1;
+        } else if (move == _killers[ply][1]) {
+            scores[i] = KillerScore;
+        } else {
+            scores[i] = _history[side][move.from][move.to];
+        }
+    }
+}
+
+void Search::pickMove(MoveList& moves, int* scores, int index)
+{
+    int best = index;
+    for (int i = index + 1; i < moves.size(); ++i) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    if (best != index) {
+        std::swap(moves[index], moves[best]);
+        std::swap(scores[index], scores[best]);
+    }
+}
+
+void Search::updateQuietCutoff(const GameState& gs, const BitMove& move, int depth, int ply)
+{
+    if (!(move == _killers[ply][0])) {
+        _killers[ply][1] = _killers[ply][0];
+        _killers[ply][0] = move;
+    }
+
+    int& entry = _history[(gs.color == WHITE) ? 0 : 1][move.from][move.to];
+    entry += depth * depth;
+    if (entry > HistoryMax) {
+        for (auto& side : _history) {
+            for (auto& from : side) {
+                for (int& value : from) {
+                    value /= 2;
+                }
+            }
+        }
+    }
+}
+
+void Search::clearOrdering()
+{
+    for (auto& killers : _killers) {
+        killers[0] = killers[1] = BitMove();
+    }
+    // history from the previous search still says something, just less
+    for (auto& side : _history) {
+        for (auto& from : side) {
+            for (int& value : from) {
+                value /= 8;
+            }
+        }
+    }
+}
+
+int Search::quiescence(GameState& gs, int ply, int alpha, int beta)
+{
+    _nodes++;
+    if (shouldStop()) {
+        return 0;
+    }
+    if (ply > _selDepth) {
+        _selDepth = ply;
+    }
+
+    const bool inCheck = gs.inCheck(gs.color);
+    // the per-ply tables are the only thing bounding a long capture sequence
+    if (ply >= MAX_PLY - 1) {
+        return staticEval(gs);
+    }
+
+    // standing pat: the side to move can usually do at least as well as doing nothing.
+    // not when in check, then every evasion is searched and having none is mate.
+    int best = NEG_INF;
+    int standPat = 0;
+    if (!inCheck) {
+        standPat = staticEval(gs);
+        if (standPat >= beta) {
+            return standPat;
+        }
+        if (standPat > alpha) {
+            alpha = standPat;
+        }
+        best = standPat;
+    }
+
+    MoveList moves;
+    gs.generateCaptures(moves);
+    if (inCheck && moves.empty()) {
+        return -(MATE_SCORE - ply);
+    }
+
+    int scores[MoveList::MaxMoves];
+    scoreMoves(gs, moves, scores, 0, ply);
+
+    for (int i = 0; i < moves.size(); ++i) {
+        pickMove(moves, scores, i);
+        const BitMove& m = moves[i];
+        if (!inCheck) {
+            // delta pruning, winning the piece outright still wouldn't reach alpha
+            if (!(m.flags & IsPromotion) && (m.flags & IsCapture)) {
+                int victim = (m.flags & EnPassant) ? Pawn : pieceTypeAt(gs, m.to);
+                if (standPat + SeeValues[victim] + DeltaMargin <= alpha) {
+                    continue;
+                }
+            }
+            // the exchange loses material
+            if (staticExchange(gs, m) < 0) {
+                continue;
+            }
+        }
+
+        gs.pushMove(m);
+        int val = -quiescence(gs, ply + 1, -beta, -alpha);
+        gs.popState();
+        if (_stopped) {
+            return 0;
+        }
+
+        if (val > best) {
+            best = val;
+        }
+        if (best > alpha) alpha = best;
+        if (alpha >= beta) break;
+    }
+
+    return best;
+}
+
+int Search::negamax(GameState& gs, int depth, int ply, int alpha, int beta)
+{
+    const int alphaOrig = alpha;
+
+    if (depth <= 0) {
+        return quiescence(gs, ply, alpha, beta);
+    }
+
+    _nodes++;
+    if (shouldStop()) {
+        return 0;
+    }
+
+    // exact result from the tables, the index has no castling or en passant
+    int8_t tbValue;
+    if (_tablebases && gs.castling == 0 && gs.enPassant == NoSquare && _tablebases->probe(gs, tbValue)) {
+        _tablebaseHits++;
+        if (tb::isWin(tbValue)) {
+            return MATE_SCORE - (ply + tb::pliesToMate(tbValue));
+        }
+        if (tb::isLoss(tbValue)) {
+            return -(MATE_SCORE - (ply + tb::pliesToMate(tbValue)));
+        }
+        return 0;
+    }
+
+    TTData tte;
+    uint16_t hashMove = 0;
+    _ttProbes++;
+    if (_tt.probe(gs.hash, tte)) {
+        _ttHits++;
+        hashMove = tte.move;
+        if (tte.depth >= depth) {
+            int ttScore = scoreFromTT(tte.score, ply);
+            if (tte.bound == BoundExact ||
+                (tte.bound == BoundLower && ttScore >= beta) ||
+                (tte.bound == BoundUpper && ttScore <= alpha)) {
+                return ttScore;
+            }
+        }
+    }
+
+    MoveList moves;
+    gs.generateAllMoves(moves);
+
+    if (moves.empty())
+    {
+        if (gs.inCheck(gs.color)) {
+            return -(MATE_SCORE - ply);
+        }
+        return 0;
+    }
+
+    _interiorNodes++;
+    int scores[MoveList::MaxMoves];
+    scoreMoves(gs, moves, scores, hashMove, ply);
+
+    int best = NEG_INF;
+    BitMove bestMove;
+
+    for (int i = 0; i < moves.size(); ++i) {
+        pickMove(moves, scores, i);
+        const BitMove& m = moves[i];
+        gs.pushMove(m);
+        int val = -negamax(gs, depth - 1, ply + 1, -beta, -alpha);
+        gs.popState();
+        // the score of an unfinished subtree means nothing, and must not reach the table
+        if (_stopped) {
+            return 0;
+        }
+
+        if (val > best) {
+            best = val;
+            bestMove = m;
+        }
+        if (best > alpha) alpha = best;
+        if (alpha >= beta) {
+            _betaCutoffs++;
+            if (i == 0) {
+                _firstMoveCutoffs++;
+            }
+            if (!(m.flags & IsCapture) && !(m.flags & IsPromotion)) {
+                updateQuietCutoff(gs, m, depth, ply);
+            }
+            break;
+        }
+    }
+
+    TTBound bound = (best <= alphaOrig) ? BoundUpper : (best >= beta) ? BoundLower : BoundExact;
+    _tt.store(gs.hash, depth, bound, scoreToTT(best, ply), TranspositionTable::packMove(bestMove));
+
+    return best;
+}
+
+BitMove Search::searchRoot(GameState& gs, int depth, int* scoreOut)
+{
+    MoveList rootMoves;
+    gs.generateAllMoves(rootMoves);
+    if (rootMoves.empty()) return BitMove();
+
+    TTData tte;
+    uint16_t hashMove = _tt.probe(gs.hash, tte) ? tte.move : 0;
+    int scores[MoveList::MaxMoves];
+    scoreMoves(gs, rootMoves, scores, hashMove, 0);
+    // the root is searched in full, sorting it once is enough
+    for (int i = 0; i < rootMoves.size(); ++i) {
+        pickMove(rootMoves, scores, i);
+    }
+
+    int alpha = NEG_INF;
+    BitMove bestMove = rootMoves[0];
+
+    for (const auto& m : rootMoves) {
+        gs.pushMove(m);
+        int val = -negamax(gs, depth - 1, 1, NEG_INF, -alpha);
+        gs.popState();
+        if (_stopped) {
+            return bestMove;
+        }
+
+        if (val > alpha) {
+            alpha = val;
+            bestMove = m;
+        }
+    }
+
+    _tt.store(gs.hash, depth, BoundExact, scoreToTT(alpha, 0), TranspositionTable::packMove(bestMove));
+    if (scoreOut) *scoreOut = alpha;
+    return bestMove;
+}
+
+SearchResult Search::think(GameState& gs, const SearchLimits& limits)
+{
+    Clock::time_point start = Clock::now();
+    _stopRequested.store(false, std::memory_order_relaxed);
+    _stopped = false;
+    _nodes = 0;
+    _nodeLimit = limits.nodes;
+    _selDepth = 0;
+    _interiorNodes = 0;
+    _betaCutoffs = 0;
+    _firstMoveCutoffs = 0;
+    _ttProbes = 0;
+    _ttHits = 0;
+    _tablebaseHits = 0;
+    clearOrdering();
+
+    // a fixed movetime is a hard limit. with a clock, aim for an even share of what is
+    // left and allow a single move up to five times that, but never the whole clock.
+    // a new iteration is only started while there's a fair chance it finishes.
+    int hardMs = 0;
+    int softMs = 0;
+    if (limits.moveTimeMs > 0) {
+        hardMs = softMs = limits.moveTimeMs;
+    } else if (limits.timeLeftMs > 0) {
+        int movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, 40) : 30;
+        int usable = std::max(1, limits.timeLeftMs - ClockReserveMs);
+        softMs = std::max(1, usable / movesToGo + limits.incrementMs * 3 / 4);
+        hardMs = std::min(usable, softMs * 5);
+        softMs = std::min(softMs, hardMs) / 2;
+    }
+    _timed = hardMs > 0;
+    _deadline = start + std::chrono::milliseconds(hardMs);
+
+    int maxDepth = MAX_SEARCH_DEPTH;
+    if (limits.maxDepth > 0 && limits.maxDepth < maxDepth) {
+        maxDepth = limits.maxDepth;
+    }
+
+    SearchResult result;
+    // the counters so far, for each finished iteration and the final result
+    auto takeCounters = [&]() {
+        result.nodes = _nodes;
+        result.interiorNodes = _interiorNodes;
+        result.betaCutoffs = _betaCutoffs;
+        result.firstMoveCutoffs = _firstMoveCutoffs;
+        result.ttProbes = _ttProbes;
+        result.ttHits = _ttHits;
+        result.tablebaseHits = _tablebaseHits;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    };
+    MoveList rootMoves;
+    gs.generateAllMoves(rootMoves);
+    if (rootMoves.empty()) {
+        return result;
+    }
+    // something legal to play even if the first iteration doesn't finish
+    result.bestMove = rootMoves[0];
+
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        int score = 0;
+        int searchDepth = std::min(depth + _depthOffset, MAX_SEARCH_DEPTH);
+        BitMove move;
+        {
+            TRACE_SCOPE_ARG("iteration", "depth", searchDepth);
+            move = searchRoot(gs, searchDepth, &score);
+        }
+        if (_stopped) {
+            break;
+        }
+        result.bestMove = move;
+        result.score = score;
+        result.depth = searchDepth;
+        result.selDepth = _selDepth;
+        if (_onIteration) {
+            takeCounters();
+            _onIteration(result);
+        }
+
+        // a forced mate won't get any shorter by looking deeper
+        if (score > MATE_BOUND || score < -MATE_BOUND) {
+            break;
+        }
+        if (softMs > 0 && Clock::now() - start >= std::chrono::milliseconds(softMs)) {
+            break;
+        }
+    }
+
+    takeCounters();
+    return result;
+}
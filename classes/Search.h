@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "GameState.h"
+#include "Nnue.h"
+#include "PawnTable.h"
+#include "Tablebase.h"
+#include "TranspositionTable.h"
+
+constexpr int NEG_INF = -1000000000;
+constexpr int POS_INF =  1000000000;
+constexpr int MATE_SCORE = 10'000'000;
+// anything beyond this is a mate score, the distance to mate is below it
+constexpr int MATE_BOUND = MATE_SCORE - 1000;
+// deepest iteration, the plies past it up to MAX_PLY are left for quiescence
+constexpr int MAX_SEARCH_DEPTH = 64;
+// longest line searched from the root, sizes the per-ply tables
+constexpr int MAX_PLY = 128;
+
+//
+// what a search is allowed to spend, zero means no limit.
+// with only maxDepth and/or nodes set the search never looks at the clock, so the
+// same position and table always give the same move.
+//
+struct SearchLimits
+{
+    int maxDepth = 0;
+    uint64_t nodes = 0;
+    int moveTimeMs = 0;         // fixed time for this move
+    int timeLeftMs = 0;         // clock remaining for the side to move
+    int incrementMs = 0;
+    int movesToGo = 0;          // moves until the next time control, 0 = sudden death
+};
+
+struct SearchResult
+{
+    BitMove bestMove;
+    int score = 0;
+    int depth = 0;              // last completed iteration
+    int selDepth = 0;           // deepest ply reached, quiescence included
+    uint64_t nodes = 0;
+    uint64_t interiorNodes = 0;     // full width nodes that got as far as searching moves
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;  // cutoffs by the first move tried, how good the ordering is
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t tablebaseHits = 0;
+    double seconds = 0;
+
+    double nodesPerSecond() const { return seconds > 0 ? nodes / seconds : 0.0; }
+    double ttHitRate() const { return ttProbes ? (double)ttHits / ttProbes : 0.0; }
+    double betaCutoffRate() const { return interiorNodes ? (double)betaCutoffs / interiorNodes : 0.0; }
+    double firstMoveCutoffRate() const { return betaCutoffs ? (double)firstMoveCutoffs / betaCutoffs : 0.0; }
+};
+
+//
+// negamax alpha-beta search over a GameState
+// one Search per thread, the transposition table can be shared between them
+//
+class Search
+{
+public:
+    Search(TranspositionTable& tt) : _tt(tt) { }
+
+    // iterative deepening until a limit runs out. an iteration that is cut off is
+    // thrown away, the result is always from the last one that finished.
+    SearchResult think(GameState& gs, const SearchLimits& limits);
+
+    // searches every root move to the given depth and returns the best one.
+    // returns a default BitMove if the side to move has no legal moves.
+    BitMove searchRoot(GameState& gs, int depth, int* scoreOut = nullptr);
+
+    int negamax(GameState& gs, int depth, int ply, int alpha, int beta);
+    // captures only until the position is quiet, so the eval never lands mid-exchange
+    int quiescence(GameState& gs, int ply, int alpha, int beta);
+
+    // safe to call from another thread, the search unwinds at its next node
+    void stop() { _stopRequested.store(true, std::memory_order_relaxed); }
+    bool stopped() const { return _stopped; }
+    uint64_t nodes() const { return _nodes; }
+
+    // a flag owned by whoever runs several searches at once, any of them stops when it is set
+    void setSharedStop(const std::atomic<bool>* flag) { _sharedStop = flag; }
+    // helper threads search this many plies past the iteration depth so they don't all
+    // walk the same tree in step
+    void setDepthOffset(int plies) { _depthOffset = plies; }
+    // evaluate with a loaded network instead of the piece-square tables, nullptr goes back.
+    // the network is only read, several searches can share one.
+    void setNetwork(const nnue::Network* network);
+    // positions the tables cover are scored from them instead of searched, nullptr turns it off
+    void setTablebases(const tb::Tablebases* tablebases) { _tablebases = tablebases; }
+    uint64_t tablebaseHits() const { return _tablebaseHits; }
+
+    // called on the searching thread after every finished iteration, for progress output
+    using IterationCallback = std::function<void(const SearchResult&)>;
+    void setIterationCallback(IterationCallback callback) { _onIteration = std::move(callback); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool shouldStop();
+    int staticEval(const GameState& gs);
+
+    // move ordering: hash move, captures by MVV-LVA, killers, then quiet moves by history
+    void scoreMoves(const GameState& gs, const MoveList& moves, int* scores, uint16_t hashMove, int ply) const;
+    // swaps the best scored move left in [index, size) into index
+    static void pickMove(MoveList& moves, int* scores, int index);
+    void updateQuietCutoff(const GameState& gs, const BitMove& move, int depth, int ply);
+    void clearOrdering();
+
+    TranspositionTable& _tt;
+    std::atomic<bool> _stopRequested{false};
+    const std::atomic<bool>* _sharedStop = nullptr;
+    int _depthOffset = 0;
+    bool _stopped = false;
+    uint64_t _nodes = 0;
+    uint64_t _nodeLimit = 0;
+    bool _timed = false;
+    Clock::time_point _deadline;
+    int _selDepth = 0;
+    uint64_t _interiorNodes = 0;
+    uint64_t _betaCutoffs = 0;
+    uint64_t _firstMoveCutoffs = 0;
+    uint64_t _ttProbes = 0;
+    uint64_t _ttHits = 0;
+
+    // two quiet moves per ply that caused a cutoff in a sibling
+    BitMove _killers[MAX_PLY][2];
+    // butterfly table, [side][from][to] credit for quiet moves that caused a cutoff
+    int _history[2][64][64] = {};
+
+    std::unique_ptr<nnue::Evaluator> _nnue;   // accumulators for this thread, when a network is set
+    PawnTable _pawnTable;                       // pawn structure terms on top of the piece-square eval
+    const tb::Tablebases* _tablebases = nullptr;
+    uint64_t _tablebaseHits = 0;
+    IterationCallback _onIteration;
+};
+
+// tapered material and piece-square score for the side to move, O(1) off GameState::psq
+int evaluate(const GameState& gs);
+// static exchange evaluation: material won or lost by the capture sequence on move.to
+// when both sides always recapture with their cheapest piece
+int staticExchange(const GameState& gs, const BitMove& move);
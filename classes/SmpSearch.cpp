@@ -0,0 +1,77 @@
+#include "SmpSearch.h"
+#include "Trace.h"
+#include <thread>
+
+SmpSearch::SmpSearch(TranspositionTable& tt, int threads) : _tt(tt)
+{
+    setThreadCount(threads);
+}
+
+void SmpSearch::setThreadCount(int threads)
+{
+    if (threads < 1) {
+        threads = 1;
+    }
+    _searches.resize(threads);
+    for (int i = 0; i < threads; ++i) {
+        if (!_searches[i]) {
+            _searches[i] = std::make_unique<Search>(_tt);
+            _searches[i]->setSharedStop(&_stop);
+            _searches[i]->setDepthOffset(i & 1);
+            _searches[i]->setNetwork(_network);
+            _searches[i]->setTablebases(_tablebases);
+        }
+    }
+}
+
+void SmpSearch::setTablebases(const tb::Tablebases* tablebases)
+{
+    _tablebases = tablebases;
+    for (auto& search : _searches) {
+        search->setTablebases(tablebases);
+    }
+}
+
+void SmpSearch::setNetwork(const nnue::Network* network)
+{
+    _network = network;
+    for (auto& search : _searches) {
+        search->setNetwork(network);
+    }
+}
+
+SearchResult SmpSearch::think(const GameState& gs, const SearchLimits& limits)
+{
+    _stop.store(false, std::memory_order_relaxed);
+
+    // helpers go as deep as the main thread will, it decides when everyone stops
+    SearchLimits helperLimits;
+    helperLimits.maxDepth = limits.maxDepth;
+
+    const int helpers = (int)_searches.size() - 1;
+    std::vector<std::unique_ptr<GameState>> positions;
+    std::vector<std::thread> threads;
+    std::vector<SearchResult> helperResults(helpers);
+    for (int i = 0; i < helpers; ++i) {
+        positions.push_back(std::make_unique<GameState>(gs));
+    }
+    for (int i = 0; i < helpers; ++i) {
+        threads.emplace_back([this, i, &positions, &helperResults, &helperLimits]() {
+            TRACE_THREAD_NAME("search helper");
+            helperResults[i] = _searches[i + 1]->think(*positions[i], helperLimits);
+        });
+    }
+
+    GameState mainPosition(gs);
+    SearchResult result = _searches[0]->think(mainPosition, limits);
+
+    _stop.store(true, std::memory_order_relaxed);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const SearchResult& helper : helperResults) {
+        result.nodes += helper.nodes;
+        result.tablebaseHits += helper.tablebaseHits;
+    }
+    return result;
+}
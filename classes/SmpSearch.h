@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Search.h"
+
+//
+// lazy SMP: every thread runs the same iterative deepening on its own copy of the
+// position, with its own killers and history, and they only talk through the shared
+// transposition table. helpers are staggered by a ply so they fill the table with
+// different parts of the tree. the main thread's result is the one played.
+//
+class SmpSearch
+{
+public:
+    SmpSearch(TranspositionTable& tt, int threads = 1);
+
+    // the main thread counts, 1 is a plain single threaded search
+    void setThreadCount(int threads);
+    int threadCount() const { return (int)_searches.size(); }
+
+    // shared by every thread, each keeps its own accumulators. nullptr for the piece-square eval
+    void setNetwork(const nnue::Network* network);
+    // read-only, shared by every thread
+    void setTablebases(const tb::Tablebases* tablebases);
+
+    // progress of the main thread, its own node count only
+    void setIterationCallback(Search::IterationCallback callback) { _searches[0]->setIterationCallback(std::move(callback)); }
+
+    // limits apply to the main thread, the helpers stop when it does. nodes in the
+    // result are summed over every thread, so a node limit is only exact with one thread.
+    SearchResult think(const GameState& gs, const SearchLimits& limits);
+
+    // safe to call from another thread while think() runs
+    void stop() { _stop.store(true, std::memory_order_relaxed); }
+
+private:
+    TranspositionTable& _tt;
+    std::vector<std::unique_ptr<Search>> _searches;   // [0] is the main thread
+    std::atomic<bool> _stop{false};
+    const nnue::Network* _network = nullptr;
+    const tb::Tablebases* _tablebases = nullptr;
+};
@@ -1,4 +1,5 @@
 #include "Sprite.h"
+#include "Trace.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include <iostream>
@@ -7,6 +8,7 @@
 // Simple helper function to load an image into a OpenGL texture with common settings
 bool Sprite::LoadTextureFromFile(const char* filename)
 {
+    TRACE_SCOPE("texture load");
     // Load from file
     int image_width = 0;
     int image_height = 0;
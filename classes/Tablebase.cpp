@@ -0,0 +1,261 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace tb {
+
+static inline int popCount(uint64_t bb)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (int)__popcnt64(bb);
+#else
+    return __builtin_popcountll(bb);
+#endif
+}
+
+// non-king pieces in the order they appear in a name and in the index
+static constexpr char PieceOrder[] = "QRBNP";
+static constexpr int OrderBoards[5] = { WHITE_QUEENS, WHITE_ROOKS, WHITE_BISHOPS, WHITE_KNIGHTS, WHITE_PAWNS };
+
+static int orderOf(char piece)
+{
+    const char* at = std::strchr(PieceOrder, piece);
+    return at ? (int)(at - PieceOrder) : -1;
+}
+
+static int materialOf(const std::string& side)
+{
+    int total = 0;
+    for (char piece : side) {
+        total += (piece == 'Q') ? 9 : (piece == 'R') ? 5 : (piece == 'B' || piece == 'N') ? 3 : (piece == 'P') ? 1 : 0;
+    }
+    return total;
+}
+
+// > 0 if a is the stronger side, 0 for identical material
+static int compareSides(const std::string& a, const std::string& b)
+{
+    if (materialOf(a) != materialOf(b)) {
+        return materialOf(a) - materialOf(b);
+    }
+    if (a.size() != b.size()) {
+        return (int)a.size() - (int)b.size();
+    }
+    for (size_t i = 1; i < a.size(); ++i) {
+        if (a[i] != b[i]) {
+            return orderOf(b[i]) - orderOf(a[i]);
+        }
+    }
+    return 0;
+}
+
+static std::string sortedSide(std::string side)
+{
+    side.erase(std::remove(side.begin(), side.end(), 'K'), side.end());
+    std::sort(side.begin(), side.end(), [](char a, char b) { return orderOf(a) < orderOf(b); });
+    return "K" + side;
+}
+
+std::string tableName(const std::string& white, const std::string& black)
+{
+    std::string strong = sortedSide(white);
+    std::string weak = sortedSide(black);
+    if (compareSides(weak, strong) > 0) {
+        std::swap(strong, weak);
+    }
+    return strong + weak;
+}
+
+bool Signature::parse(const std::string& text)
+{
+    const size_t split = text.find('K', 1);
+    if (text.empty() || text[0] != 'K' || split == std::string::npos || text.size() > (size_t)MaxPieces) {
+        return false;
+    }
+    for (size_t i = 1; i < text.size(); ++i) {
+        if (i != split && orderOf(text[i]) < 0) {
+            return false;
+        }
+    }
+
+    name = tableName(text.substr(0, split), text.substr(split));
+    count = (int)name.size();
+    const size_t blackKing = name.find('K', 1);
+    boards[0] = WHITE_KING;
+    boards[1] = BLACK_KING;
+    int slot = 2;
+    for (size_t i = 1; i < name.size(); ++i) {
+        if (i < blackKing) {
+            boards[slot++] = bitboardForPiece[(unsigned char)name[i]];
+        } else if (i > blackKing) {
+            boards[slot++] = bitboardForPiece[(unsigned char)std::tolower(name[i])];
+        }
+    }
+    return true;
+}
+
+uint64_t Signature::entries() const
+{
+    return 2ULL << (6 * count);
+}
+
+uint64_t indexOf(const Signature& signature, const int* squares, bool whiteToMove)
+{
+    uint64_t index = 0;
+    for (int i = 0; i < signature.count; ++i) {
+        index = index * 64 + squares[i];
+    }
+    return index * 2 + (whiteToMove ? 0 : 1);
+}
+
+void squaresOf(const Signature& signature, uint64_t index, int* squares, bool& whiteToMove)
+{
+    whiteToMove = (index & 1) == 0;
+    index >>= 1;
+    for (int i = signature.count - 1; i >= 0; --i) {
+        squares[i] = (int)(index & 63);
+        index >>= 6;
+    }
+}
+
+std::vector<std::string> Tablebases::names() const
+{
+    std::vector<std::string> result;
+    for (const auto& entry : _tables) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+void Tablebases::add(const Signature& signature, std::vector<int8_t> values)
+{
+    Table& table = _tables[signature.name];
+    table.signature = signature;
+    table.file.reset();
+    table.owned = std::move(values);
+    table.values = table.owned.data();
+    _maxPieces = std::max(_maxPieces, signature.count);
+}
+
+bool Tablebases::load(const std::string& path)
+{
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(FileHeader)) {
+        return false;
+    }
+    FileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    char name[sizeof(header.name) + 1] = {};
+    std::memcpy(name, header.name, sizeof(header.name));
+
+    Signature signature;
+    if (std::memcmp(header.magic, "CHESSTB1", 8) != 0 || !signature.parse(name) || signature.name != name ||
+        header.pieces != (uint32_t)signature.count || header.entries != signature.entries() ||
+        file->size() != sizeof(FileHeader) + header.entries) {
+        return false;
+    }
+
+    Table& table = _tables[signature.name];
+    table.signature = signature;
+    table.owned.clear();
+    table.values = (const int8_t*)file->data() + sizeof(FileHeader);
+    table.file = std::move(file);
+    _maxPieces = std::max(_maxPieces, signature.count);
+    return true;
+}
+
+int Tablebases::loadDirectory(const std::string& directory)
+{
+    std::error_code error;
+    int loaded = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() == ".tb" && load(entry.path().string())) {
+            loaded++;
+        }
+    }
+    return loaded;
+}
+
+bool Tablebases::save(const std::string& name, const std::string& path) const
+{
+    auto found = _tables.find(name);
+    if (found == _tables.end()) {
+        return false;
+    }
+    const Table& table = found->second;
+
+    FileHeader header = {};
+    std::memcpy(header.magic, "CHESSTB1", 8);
+    std::memcpy(header.name, name.data(), std::min(name.size(), sizeof(header.name)));
+    header.pieces = (uint32_t)table.signature.count;
+    header.entries = table.signature.entries();
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(table.values, 1, header.entries, file) == header.entries;
+    return std::fclose(file) == 0 && ok;
+}
+
+bool Tablebases::probe(const GameStateData& position, int8_t& value) const
+{
+    const int pieces = popCount(position._bitboards[OCCUPANCY].getData());
+    if (pieces == 2) {
+        value = Draw;
+        return true;
+    }
+    if (pieces > _maxPieces) {
+        return false;
+    }
+
+    // each side's pieces in name order, equal pieces by ascending square
+    std::string sides[2] = { "K", "K" };
+    int others[2][MaxPieces];
+    int otherCount[2] = { 0, 0 };
+    for (int side = 0; side < 2; ++side) {
+        const int offset = side ? BLACK_PAWNS : WHITE_PAWNS;
+        for (int i = 0; i < 5; ++i) {
+            position._bitboards[OrderBoards[i] + offset].forEachBit([&](int square) {
+                if (otherCount[side] < MaxPieces - 2) {
+                    sides[side] += PieceOrder[i];
+                    others[side][otherCount[side]++] = square;
+                }
+            });
+        }
+    }
+
+    // the table has the stronger side as white, otherwise look at the board from black's side
+    const bool flip = compareSides(sides[1], sides[0]) > 0;
+    const int strong = flip ? 1 : 0;
+    const int mirror = flip ? 56 : 0;
+    auto found = _tables.find(sides[strong] + sides[strong ^ 1]);
+    if (found == _tables.end()) {
+        return false;
+    }
+    const Table& table = found->second;
+
+    int squares[MaxPieces];
+    int slot = 0;
+    squares[slot++] = position._bitboards[strong ? BLACK_KING : WHITE_KING].firstBit() ^ mirror;
+    squares[slot++] = position._bitboards[strong ? WHITE_KING : BLACK_KING].firstBit() ^ mirror;
+    for (int side : { strong, strong ^ 1 }) {
+        for (int i = 0; i < otherCount[side]; ++i) {
+            squares[slot++] = others[side][i] ^ mirror;
+        }
+    }
+    // mirroring reverses the order of two equal pieces
+    if (table.signature.count == 4 && table.signature.boards[2] == table.signature.boards[3] && squares[2] > squares[3]) {
+        std::swap(squares[2], squares[3]);
+    }
+
+    const bool whiteToMove = (position.color == WHITE) != flip;
+    value = table.values[indexOf(table.signature, squares, whiteToMove)];
+    return value != Illegal;
+}
+
+} // namespace tb
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GameState.h"
+#include "MappedFile.h"
+
+//
+// endgame tablebases: the exact result and distance to mate of every position with a
+// given set of pieces, built by retrograde analysis and probed by the search
+//
+// a table is named by its material, white's pieces then black's, each starting with
+// the king: "KQK", "KRKP". only the orientation with the stronger side as white is
+// stored, a position with the colours the other way round is mirrored on probe.
+//
+// every entry is one signed byte for the side to move:
+//   v > 0  mates in v plies
+//   v < 0  is mated in -v - 1 plies, so -1 is checkmate on the board
+//   v = 0  draw
+// castling and en passant are not part of the index, the search doesn't probe
+// positions that still have them.
+//
+namespace tb {
+
+constexpr int MaxPieces = 4;            // kings included, 2 * 64^4 entries is the largest table
+constexpr int8_t Draw = 0;
+constexpr int8_t Illegal = -128;         // side not to move in check, pieces overlapping, ...
+
+// plies to mate from a probed value, and the value the other side sees one ply back
+inline bool isWin(int8_t value) { return value > 0; }
+inline bool isLoss(int8_t value) { return value < 0 && value != Illegal; }
+inline int pliesToMate(int8_t value) { return value > 0 ? value : -value - 1; }
+
+// piece slots of a table in index order: white king, black king, white's other pieces,
+// black's other pieces. each slot holds an AllBitBoards piece board.
+struct Signature
+{
+    std::string name;
+    int count = 0;
+    int boards[MaxPieces] = {};
+
+    // "KRKP" and the like, false for anything that isn't two kings plus at most two pieces
+    bool parse(const std::string& text);
+    uint64_t entries() const;
+};
+
+//
+// file layout: this header, then int8 values[entries] in index order
+//
+struct FileHeader
+{
+    char magic[8];          // "CHESSTB1"
+    char name[8];           // signature, zero padded
+    uint32_t pieces;
+    uint32_t reserved;
+    uint64_t entries;
+};
+static_assert(sizeof(FileHeader) == 32, "the values start 32 bytes in");
+
+// table name for two sides given as piece letters ("KR", "KP"), in any order.
+// the pieces are sorted and the stronger side goes first.
+std::string tableName(const std::string& white, const std::string& black);
+
+// index of the piece squares (in slot order) with white or black to move
+uint64_t indexOf(const Signature& signature, const int* squares, bool whiteToMove);
+void squaresOf(const Signature& signature, uint64_t index, int* squares, bool& whiteToMove);
+
+class Tablebases
+{
+public:
+    // maps one table file, false if it is missing or malformed
+    bool load(const std::string& path);
+    // every *.tb file in a directory, returns how many loaded
+    int loadDirectory(const std::string& directory);
+    bool save(const std::string& name, const std::string& path) const;
+
+    // takes over a table built in memory
+    void add(const Signature& signature, std::vector<int8_t> values);
+    bool has(const std::string& name) const { return _tables.count(name) != 0; }
+    std::vector<std::string> names() const;
+    // most pieces of any loaded table, 0 when there are none
+    int maxPieces() const { return _maxPieces; }
+
+    // value for the side to move, false when no table covers the position.
+    // bare kings are a draw without a table.
+    bool probe(const GameStateData& position, int8_t& value) const;
+
+private:
+    struct Table
+    {
+        Signature signature;
+        const int8_t* values = nullptr;
+        std::vector<int8_t> owned;              // tables built in memory
+        std::unique_ptr<MappedFile> file;       // tables loaded from disk
+    };
+
+    std::map<std::string, Table> _tables;
+    int _maxPieces = 0;
+};
+
+} // namespace tb
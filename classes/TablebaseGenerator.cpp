@@ -0,0 +1,358 @@
+#include "TablebaseGenerator.h"
+#include "MagicBitboards.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <utility>
+
+namespace tb {
+
+// not yet resolved, never written to a table
+static constexpr int8_t Unknown = 127;
+// longest distance a byte can hold, far beyond any four piece ending
+static constexpr int MaxPlies = 126;
+// exit bytes above the longest loss: a capture or promotion that draws, or one that wins
+static constexpr uint8_t ExitDraws = 0xFE;
+static constexpr uint8_t ExitWins = 0xFF;
+// positions per task
+static constexpr uint64_t Chunk = 1 << 14;
+
+// the tables a capture or promotion out of signature can reach
+static std::vector<std::string> dependencies(const Signature& signature)
+{
+    const size_t split = signature.name.find('K', 1);
+    const std::string sides[2] = { signature.name.substr(0, split), signature.name.substr(split) };
+
+    std::vector<std::string> names;
+    auto addName = [&names](const std::string& white, const std::string& black) {
+        if (white.size() + black.size() > 2) {
+            names.push_back(tableName(white, black));
+        }
+    };
+    auto without = [](const std::string& side, size_t at) {
+        return side.substr(0, at) + side.substr(at + 1);
+    };
+    for (int us = 0; us < 2; ++us) {
+        const std::string& ours = sides[us];
+        const std::string& theirs = sides[us ^ 1];
+        for (size_t i = 1; i < theirs.size(); ++i) {
+            addName(ours, without(theirs, i));
+        }
+        for (size_t i = 1; i < ours.size(); ++i) {
+            if (ours[i] != 'P') {
+                continue;
+            }
+            for (char promoted : { 'Q', 'R', 'B', 'N' }) {
+                std::string side = ours;
+                side[i] = promoted;
+                addName(side, theirs);
+                for (size_t j = 1; j < theirs.size(); ++j) {
+                    addName(side, without(theirs, j));
+                }
+            }
+        }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+static inline bool isWhiteBoard(int board)
+{
+    return board < WHITE_ALL_PIECES;
+}
+
+// two equal pieces are only indexed with the lower square first, the other order is unused
+static inline void sortEqualPieces(const Signature& signature, int* squares)
+{
+    if (signature.count == 4 && signature.boards[2] == signature.boards[3] && squares[2] > squares[3]) {
+        std::swap(squares[2], squares[3]);
+    }
+}
+
+static bool validLayout(const Signature& signature, const int* squares)
+{
+    uint64_t occupied = 0;
+    for (int i = 0; i < signature.count; ++i) {
+        const uint64_t bit = 1ULL << squares[i];
+        if (occupied & bit) {
+            return false;
+        }
+        occupied |= bit;
+        if (signature.boards[i] % 7 == WHITE_PAWNS && (bit & (Rank1 | Rank8))) {
+            return false;
+        }
+    }
+    return !(signature.count == 4 && signature.boards[2] == signature.boards[3] && squares[2] > squares[3]);
+}
+
+// every position one non-capturing, non-promoting move before index
+template <typename Visit>
+static void forEachPredecessor(const Signature& signature, uint64_t index, Visit visit)
+{
+    int squares[MaxPieces];
+    bool whiteToMove;
+    squaresOf(signature, index, squares, whiteToMove);
+    uint64_t occupied = 0;
+    for (int i = 0; i < signature.count; ++i) {
+        occupied |= 1ULL << squares[i];
+    }
+    const uint64_t empty = ~occupied;
+
+    // the side that just moved
+    const bool whiteMoved = !whiteToMove;
+    for (int i = 0; i < signature.count; ++i) {
+        const int board = signature.boards[i];
+        if (isWhiteBoard(board) != whiteMoved) {
+            continue;
+        }
+        const int square = squares[i];
+        uint64_t from = 0;
+        switch (board % 7) {
+            case WHITE_PAWNS: {
+                // back one square, or two from the fourth (fifth for black) rank
+                const int back = whiteMoved ? -8 : 8;
+                const int origin = square + back;
+                if (origin >= 8 && origin < 56 && (empty & (1ULL << origin))) {
+                    from |= 1ULL << origin;
+                    const int startRank = whiteMoved ? 3 : 4;
+                    if (square / 8 == startRank && (empty & (1ULL << (origin + back)))) {
+                        from |= 1ULL << (origin + back);
+                    }
+                }
+                break;
+            }
+            case WHITE_KNIGHTS: from = KnightAttacks[square] & empty; break;
+            case WHITE_BISHOPS: from = getBishopAttacks(square, occupied) & empty; break;
+            case WHITE_ROOKS:   from = getRookAttacks(square, occupied) & empty; break;
+            case WHITE_QUEENS:  from = getQueenAttacks(square, occupied) & empty; break;
+            case WHITE_KING:    from = KingAttacks[square] & empty; break;
+        }
+
+        BitBoard(from).forEachBit([&](int origin) {
+            int before[MaxPieces];
+            std::copy(squares, squares + signature.count, before);
+            before[i] = origin;
+            sortEqualPieces(signature, before);
+            visit(indexOf(signature, before, whiteMoved));
+        });
+    }
+}
+
+// runs body(begin, end) over [0, count) in chunks on the pool
+template <typename Body>
+static void parallelFor(ThreadPool& pool, uint64_t count, Body& body)
+{
+    for (uint64_t begin = 0; begin < count; begin += Chunk) {
+        const uint64_t end = std::min(begin + Chunk, count);
+        pool.submit([&body, begin, end]() { body(begin, end); });
+    }
+    pool.wait();
+}
+
+static bool generateTable(Tablebases& tablebases, const Signature& signature, ThreadPool& pool, bool verbose)
+{
+    auto start = std::chrono::steady_clock::now();
+    const uint64_t count = signature.entries();
+
+    std::unique_ptr<std::atomic<int8_t>[]> values(new std::atomic<int8_t>[count]);
+    // in-table moves whose result isn't known yet
+    std::unique_ptr<std::atomic<uint8_t>[]> remaining(new std::atomic<uint8_t>[count]);
+    // what the best capture or promotion gets: ExitWins, ExitDraws, or the longest loss
+    std::unique_ptr<uint8_t[]> exits(new uint8_t[count]);
+
+    // buckets[n] holds positions that may resolve n plies from mate
+    std::vector<std::vector<uint32_t>> buckets(MaxPlies + 2);
+    std::mutex bucketMutex;
+    std::atomic<bool> failed{false};
+    auto flush = [&](std::vector<std::pair<int, uint32_t>>& local) {
+        std::lock_guard<std::mutex> lock(bucketMutex);
+        for (const auto& entry : local) {
+            if (entry.first > MaxPlies) {
+                failed = true;
+            } else {
+                buckets[entry.first].push_back(entry.second);
+            }
+        }
+        local.clear();
+    };
+
+    // pass one: legality, move counts and everything leaving the table
+    auto setup = [&](uint64_t begin, uint64_t end) {
+        auto gs = std::make_unique<GameState>();
+        std::vector<std::pair<int, uint32_t>> local;
+        MoveList moves;
+        char board[64];
+        for (uint64_t index = begin; index < end; ++index) {
+            int squares[MaxPieces];
+            bool whiteToMove;
+            squaresOf(signature, index, squares, whiteToMove);
+            if (!validLayout(signature, squares)) {
+                values[index].store(Illegal, std::memory_order_relaxed);
+                continue;
+            }
+            std::memset(board, '0', sizeof(board));
+            for (int i = 0; i < signature.count; ++i) {
+                board[squares[i]] = "PNBRQK PNBRQK"[signature.boards[i]];
+                if (!isWhiteBoard(signature.boards[i])) {
+                    board[squares[i]] += 'a' - 'A';
+                }
+            }
+            const char us = whiteToMove ? WHITE : BLACK;
+            gs->init(board, us);
+            gs->castling = 0;
+            if (gs->inCheck(-us)) {
+                values[index].store(Illegal, std::memory_order_relaxed);
+                continue;
+            }
+
+            values[index].store(Unknown, std::memory_order_relaxed);
+            gs->generateAllMoves(moves);
+            if (moves.empty()) {
+                if (gs->inCheck(us)) {
+                    local.emplace_back(0, (uint32_t)index);
+                } else {
+                    values[index].store(Draw, std::memory_order_relaxed);
+                }
+                continue;
+            }
+
+            int inTable = 0;
+            int bestWin = 0;
+            int longestLoss = 0;
+            bool drawExit = false;
+            for (const BitMove& move : moves) {
+                if (!(move.flags & (IsCapture | IsPromotion))) {
+                    inTable++;
+                    continue;
+                }
+                gs->pushMove(move);
+                int8_t child = Draw;
+                if (!tablebases.probe(*gs, child)) {
+                    failed = true;
+                }
+                gs->popState();
+                if (isLoss(child)) {
+                    const int plies = pliesToMate(child) + 1;
+                    bestWin = bestWin ? std::min(bestWin, plies) : plies;
+                } else if (isWin(child)) {
+                    longestLoss = std::max(longestLoss, child + 1);
+                } else {
+                    drawExit = true;
+                }
+            }
+
+            remaining[index].store((uint8_t)inTable, std::memory_order_relaxed);
+            exits[index] = bestWin ? ExitWins : drawExit ? ExitDraws : (uint8_t)longestLoss;
+            if (bestWin) {
+                local.emplace_back(bestWin, (uint32_t)index);
+            } else if (inTable == 0) {
+                if (drawExit) {
+                    values[index].store(Draw, std::memory_order_relaxed);
+                } else {
+                    local.emplace_back(longestLoss, (uint32_t)index);
+                }
+            }
+        }
+        flush(local);
+    };
+    parallelFor(pool, count, setup);
+
+    // pass two: resolve ply by ply, so the first value a position gets is its shortest win
+    // or longest loss
+    for (int plies = 0; plies <= MaxPlies && !failed; ++plies) {
+        std::vector<uint32_t> level = std::move(buckets[plies]);
+        if (level.empty()) {
+            continue;
+        }
+        const bool lost = (plies & 1) == 0;
+        const int8_t resolved = lost ? (int8_t)(-plies - 1) : (int8_t)plies;
+        auto retro = [&](uint64_t begin, uint64_t end) {
+            std::vector<std::pair<int, uint32_t>> local;
+            for (uint64_t i = begin; i < end; ++i) {
+                const uint32_t index = level[i];
+                int8_t expected = Unknown;
+                if (!values[index].compare_exchange_strong(expected, resolved, std::memory_order_relaxed)) {
+                    continue;
+                }
+                forEachPredecessor(signature, index, [&](uint64_t before) {
+                    if (values[before].load(std::memory_order_relaxed) != Unknown) {
+                        return;
+                    }
+                    if (lost) {
+                        local.emplace_back(plies + 1, (uint32_t)before);
+                    } else if (remaining[before].fetch_sub(1, std::memory_order_relaxed) == 1 && exits[before] < ExitDraws) {
+                        local.emplace_back(std::max(plies + 1, (int)exits[before]), (uint32_t)before);
+                    }
+                });
+            }
+            flush(local);
+        };
+        parallelFor(pool, level.size(), retro);
+    }
+    if (failed) {
+        std::fprintf(stderr, "%s: a dependency is missing or a mate is too long for the format\n", signature.name.c_str());
+        return false;
+    }
+
+    std::vector<int8_t> table(count);
+    uint64_t wins = 0, losses = 0, draws = 0;
+    int longest = 0;
+    for (uint64_t index = 0; index < count; ++index) {
+        int8_t value = values[index].load(std::memory_order_relaxed);
+        if (value == Unknown) {
+            value = Draw;
+        }
+        table[index] = value;
+        if (isWin(value)) {
+            wins++;
+            longest = std::max(longest, (int)value);
+        } else if (isLoss(value)) {
+            losses++;
+        } else if (value == Draw) {
+            draws++;
+        }
+    }
+    tablebases.add(signature, std::move(table));
+
+    if (verbose) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-6s %10llu wins %10llu losses %10llu draws, longest mate %d plies, %.2f s\n",
+                    signature.name.c_str(), (unsigned long long)wins, (unsigned long long)losses,
+                    (unsigned long long)draws, longest, seconds);
+    }
+    return true;
+}
+
+static bool generateWithDependencies(Tablebases& tablebases, const Signature& signature, ThreadPool& pool, bool verbose)
+{
+    if (tablebases.has(signature.name)) {
+        return true;
+    }
+    for (const std::string& name : dependencies(signature)) {
+        Signature dependency;
+        if (!dependency.parse(name) || !generateWithDependencies(tablebases, dependency, pool, verbose)) {
+            return false;
+        }
+    }
+    return generateTable(tablebases, signature, pool, verbose);
+}
+
+bool generate(Tablebases& tablebases, const std::string& name, int threads, bool verbose)
+{
+    Signature signature;
+    if (!signature.parse(name)) {
+        return false;
+    }
+    // the first GameState::init builds the attack tables, before any worker needs them
+    GameState warmup;
+    warmup.initFromFEN(StartPositionFEN);
+
+    ThreadPool pool(threads);
+    return generateWithDependencies(tablebases, signature, pool, verbose);
+}
+
+} // namespace tb
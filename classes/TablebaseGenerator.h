@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include "Tablebase.h"
+
+namespace tb {
+
+//
+// retrograde tablebase generation
+//
+// every position of the table is set up once on a GameState to count its legal moves
+// and to look up the captures and promotions, which lead into smaller (or other)
+// tables built first. from the mates outwards, each resolved position then walks its
+// predecessors with un-moves: a lost position makes every predecessor won one ply
+// later, a won position knocks one move off each predecessor's count and the
+// predecessors with no moves left are lost. whatever is never resolved is a draw.
+// both passes are split across a work-stealing pool.
+//
+
+// builds the named table and everything it depends on, skipping tables already in
+// tablebases. progress goes to stdout when verbose.
+bool generate(Tablebases& tablebases, const std::string& name, int threads, bool verbose = false);
+
+} // namespace tb
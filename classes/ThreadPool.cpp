@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+// index of the pool worker running on this thread, -1 for any other thread
+static thread_local int t_workerIndex = -1;
+static thread_local const ThreadPool* t_workerPool = nullptr;
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        _queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        _threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_stateMutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    int index = (t_workerPool == this) ? t_workerIndex : (int)(_nextQueue++ % _queues.size());
+    _pending++;
+    {
+        // counted before it is visible so _queued never drops below zero, and under the
+        // lock so a worker can't check _queued and go to sleep in between
+        std::lock_guard<std::mutex> lock(_stateMutex);
+        _queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+        _queues[index]->tasks.push_back(std::move(task));
+    }
+    _workAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_stateMutex);
+    _allDone.wait(lock, [this] { return _pending.load() == 0; });
+}
+
+bool ThreadPool::popLocal(int index, std::function<void()>& task)
+{
+    WorkerQueue& queue = *_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int thief, std::function<void()>& task)
+{
+    const int count = (int)_queues.size();
+    for (int offset = 1; offset < count; ++offset) {
+        WorkerQueue& queue = *_queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    t_workerIndex = index;
+    t_workerPool = this;
+
+    std::function<void()> task;
+    for (;;) {
+        if (popLocal(index, task) || steal(index, task)) {
+            _queued--;
+            task();
+            task = nullptr;
+            if (--_pending == 0) {
+                std::lock_guard<std::mutex> lock(_stateMutex);
+                _allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_stateMutex);
+        _workAvailable.wait(lock, [this] { return _stopping || _queued.load() > 0; });
+        if (_stopping && _queued.load() == 0) {
+            return;
+        }
+    }
+}
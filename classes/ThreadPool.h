@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// work-stealing thread pool
+//
+// every worker owns a deque. a worker takes its newest task from the back of its own
+// deque and, when that runs dry, steals the oldest task from the front of another
+// worker's deque. tasks submitted from inside a worker go to that worker's deque, so
+// a task that splits itself keeps its subtasks local until someone is idle.
+//
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // blocks until every task submitted so far (and everything they submitted) has run
+    void wait();
+
+    int size() const { return (int)_threads.size(); }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(int index);
+    bool popLocal(int index, std::function<void()>& task);
+    bool steal(int thief, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::vector<std::thread> _threads;
+
+    std::mutex _stateMutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _allDone;
+    std::atomic<int> _queued{0};    // submitted but not yet picked up
+    std::atomic<int> _pending{0};   // submitted but not yet finished
+    std::atomic<unsigned> _nextQueue{0};
+    bool _stopping = false;
+};
@@ -0,0 +1,141 @@
+#include "Trace.h"
+
+#if defined(CHESS_TRACING)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+constexpr uint64_t Capacity = BufferCapacity;
+
+struct Event
+{
+    const char* name;
+    const char* argName;
+    int64_t arg;
+    uint64_t start;
+    uint64_t end;
+};
+
+// the buffer's index is its tid in the trace, so a reused buffer stays on the same row
+struct Buffer
+{
+    Event events[Capacity];
+    std::atomic<uint64_t> written{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<bool> inUse{false};
+    int id = 0;
+};
+
+std::mutex registryMutex;
+
+std::vector<std::unique_ptr<Buffer>>& buffers()
+{
+    static std::vector<std::unique_ptr<Buffer>> all;
+    return all;
+}
+
+// once per thread, the only place a lock is taken while recording
+Buffer* acquire()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : buffers()) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true)) {
+            buffer->name.store(nullptr, std::memory_order_relaxed);
+            return buffer.get();
+        }
+    }
+    buffers().push_back(std::make_unique<Buffer>());
+    Buffer* buffer = buffers().back().get();
+    buffer->id = (int)buffers().size();
+    buffer->inUse.store(true);
+    return buffer;
+}
+
+// gives the buffer back when its thread exits
+struct ThreadSlot
+{
+    Buffer* buffer = nullptr;
+    ~ThreadSlot()
+    {
+        if (buffer) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadSlot slot;
+
+Buffer& local()
+{
+    if (!slot.buffer) {
+        slot.buffer = acquire();
+    }
+    return *slot.buffer;
+}
+
+} // namespace
+
+uint64_t now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void record(const char* name, uint64_t start, uint64_t end, const char* argName, int64_t arg)
+{
+    Buffer& buffer = local();
+    const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index & (Capacity - 1)] = { name, argName, arg, start, end };
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void setThreadName(const char* name)
+{
+    local().name.store(name, std::memory_order_relaxed);
+}
+
+bool dump(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    const char* separator = "";
+    for (const auto& buffer : buffers()) {
+        if (const char* name = buffer->name.load(std::memory_order_relaxed)) {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                         separator, buffer->id, name);
+            separator = ",\n";
+        }
+        // only the newest Capacity events survive a full ring
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const uint64_t first = written > Capacity ? written - Capacity : 0;
+        for (uint64_t i = first; i < written; ++i) {
+            const Event& event = buffer->events[i & (Capacity - 1)];
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", separator,
+                         event.name, buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+            if (event.argName) {
+                std::fprintf(file, ",\"args\":{\"%s\":%lld}", event.argName, (long long)event.arg);
+            }
+            std::fprintf(file, "}");
+            separator = ",\n";
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+} // namespace trace
+
+#endif
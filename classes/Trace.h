@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//
+// scoped timing events in Chrome's trace_event format, for chrome://tracing or Perfetto
+//
+// off unless built with -DCHESS_TRACING=ON. the TRACE_ macros then compile to nothing
+// and none of this exists in the binary.
+//
+// each thread records into its own fixed ring buffer: taking a timestamp and writing an
+// event is a plain store and one release increment, no lock and no allocation. a full
+// ring overwrites its oldest events. buffers outlive their threads and are handed to the
+// next new thread, so per-search worker threads don't grow memory. TRACE_DUMP writes
+// every buffer out once the other threads are done.
+//
+// names and argument names must be string literals, only the pointer is kept.
+//
+//   TRACE_SCOPE("updateAI");
+//   TRACE_SCOPE_ARG("iteration", "depth", depth);
+//   TRACE_THREAD_NAME("search");
+//   TRACE_DUMP("chess_trace.json");
+//
+#if defined(CHESS_TRACING)
+
+namespace trace {
+
+// events kept per thread, a power of two
+constexpr uint64_t BufferCapacity = 1 << 15;
+
+// nanoseconds since the first call
+uint64_t now();
+
+void record(const char* name, uint64_t start, uint64_t end, const char* argName, int64_t arg);
+void setThreadName(const char* name);
+// the whole trace as JSON, false if the file can't be written
+bool dump(const std::string& path);
+
+class Scope
+{
+public:
+    Scope(const char* name, const char* argName = nullptr, int64_t arg = 0)
+        : _name(name), _argName(argName), _arg(arg), _start(now()) { }
+    ~Scope() { record(_name, _start, now(), _argName, _arg); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* _name;
+    const char* _argName;
+    int64_t _arg;
+    uint64_t _start;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, argName, arg) trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name, argName, (int64_t)(arg))
+#define TRACE_THREAD_NAME(name) trace::setThreadName(name)
+#define TRACE_DUMP(path) trace::dump(path)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_ARG(name, argName, arg) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_DUMP(path) ((void)0)
+
+#endif
@@ -0,0 +1,123 @@
+#include "TranspositionTable.h"
+
+static constexpr int DataScoreShift = 0;
+static constexpr int DataMoveShift = 32;
+static constexpr int DataDepthShift = 48;
+static constexpr int DataBoundShift = 56;
+static constexpr int DataAgeShift = 58;
+
+TranspositionTable::TranspositionTable(size_t sizeMB) : _bucketCount(0), _age(0)
+{
+    resize(sizeMB);
+}
+
+void TranspositionTable::resize(size_t sizeMB)
+{
+    size_t wanted = (sizeMB < 1 ? 1 : sizeMB) << 20;
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= wanted) {
+        count *= 2;
+    }
+    if (count != _bucketCount) {
+        _buckets.reset(new Bucket[count]);
+        _bucketCount = count;
+    }
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i < _bucketCount; ++i) {
+        for (Entry& entry : _buckets[i].entries) {
+            entry.key.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    _age = 0;
+}
+
+uint16_t TranspositionTable::packMove(const BitMove& move)
+{
+    int promotion = move.promotionPiece();
+    return (uint16_t)(move.from | (move.to << 6) | (promotion << 12));
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& out) const
+{
+    const Bucket& bucket = bucketFor(key);
+    for (const Entry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if ((entry.key.load(std::memory_order_relaxed) ^ data) != key || data == 0) {
+            continue;
+        }
+        out.score = (int32_t)(uint32_t)(data >> DataScoreShift);
+        out.move = (uint16_t)(data >> DataMoveShift);
+        out.depth = (int)((data >> DataDepthShift) & 0xFF);
+        out.bound = (TTBound)((data >> DataBoundShift) & 3);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, TTBound bound, int score, uint16_t move)
+{
+    Bucket& bucket = bucketFor(key);
+
+    // same position already stored, otherwise the entry worth the least:
+    // shallow entries from older searches go first
+    Entry* replace = nullptr;
+    int replaceWorth = 0;
+    uint64_t replaceData = 0;
+    for (Entry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if ((entry.key.load(std::memory_order_relaxed) ^ data) == key) {
+            replace = &entry;
+            replaceData = data;
+            break;
+        }
+        int entryDepth = (int)((data >> DataDepthShift) & 0xFF);
+        int entryAge = (int)((data >> DataAgeShift) & 63);
+        int worth = entryDepth - 8 * ((_age - entryAge) & 63);
+        if (!replace || worth < replaceWorth) {
+            replace = &entry;
+            replaceWorth = worth;
+            replaceData = data;
+        }
+    }
+
+    bool sameKey = ((replace->key.load(std::memory_order_relaxed) ^ replaceData) == key);
+    if (sameKey) {
+        // keep the old best move if this search didn't produce one, and don't let a
+        // shallow bound overwrite a deeper result for the same position
+        if (move == 0) {
+            move = (uint16_t)(replaceData >> DataMoveShift);
+        }
+        int oldDepth = (int)((replaceData >> DataDepthShift) & 0xFF);
+        if (bound != BoundExact && depth + 2 < oldDepth && ((replaceData >> DataAgeShift) & 63) == _age) {
+            return;
+        }
+    }
+
+    uint64_t data = ((uint64_t)(uint32_t)score << DataScoreShift) |
+                    ((uint64_t)move << DataMoveShift) |
+                    ((uint64_t)(depth < 0 ? 0 : depth > 255 ? 255 : depth) << DataDepthShift) |
+                    ((uint64_t)bound << DataBoundShift) |
+                    ((uint64_t)_age << DataAgeShift);
+    replace->key.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t samples = _bucketCount < 250 ? _bucketCount : 250;
+    int used = 0;
+    for (size_t i = 0; i < samples; ++i) {
+        for (const Entry& entry : _buckets[i].entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            if (data != 0 && ((data >> DataAgeShift) & 63) == _age) {
+                used++;
+            }
+        }
+    }
+    return samples ? (int)(used * 1000 / (samples * EntriesPerBucket)) : 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "GameState.h"
+
+//
+// shared transposition table for the chess search
+//
+// entries are two 64-bit words, the key is stored xored with the data so a torn
+// write from another thread fails the key check instead of returning a mix of
+// two positions. no locks are taken, the worst a race can do is lose an entry.
+//
+// data word layout:
+//  bits  0-31  score (mate scores are stored relative to the node, see Search.cpp)
+//  bits 32-47  move: from (6) | to (6) | promotion piece (3)
+//  bits 48-55  depth
+//  bits 56-57  bound
+//  bits 58-63  age of the search that wrote it
+//
+enum TTBound : uint8_t
+{
+    BoundNone = 0,
+    BoundUpper = 1,     // score <= real value could not be proven higher (fail low)
+    BoundLower = 2,     // score >= real value, caused a beta cutoff (fail high)
+    BoundExact = 3
+};
+
+struct TTData
+{
+    int         score;
+    uint16_t    move;
+    int         depth;
+    TTBound     bound;
+};
+
+class TranspositionTable
+{
+public:
+    static constexpr size_t DefaultSizeMB = 16;
+
+    TranspositionTable(size_t sizeMB = DefaultSizeMB);
+
+    // rounds down to a power of two number of buckets, clears the table
+    void resize(size_t sizeMB);
+    void clear();
+    size_t sizeMB() const { return (_bucketCount * sizeof(Bucket)) >> 20; }
+
+    // call once per updateAI so entries from earlier moves age out first
+    void newSearch() { _age = (_age + 1) & 63; }
+
+    bool probe(uint64_t key, TTData& out) const;
+    void store(uint64_t key, int depth, TTBound bound, int score, uint16_t move);
+
+    // permille of sampled entries written by the current search
+    int hashfull() const;
+
+    static uint16_t packMove(const BitMove& move);
+    static bool sameMove(uint16_t packed, const BitMove& move) { return packed != 0 && packed == packMove(move); }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+    static constexpr int EntriesPerBucket = 4;
+    struct alignas(64) Bucket
+    {
+        Entry entries[EntriesPerBucket];
+    };
+
+    Bucket& bucketFor(uint64_t key) const { return _buckets[key & (_bucketCount - 1)]; }
+
+    std::unique_ptr<Bucket[]> _buckets;
+    size_t _bucketCount;
+    uint8_t _age;
+};
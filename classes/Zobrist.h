@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+//
+// zobrist keys for GameState hashing
+// pieces are indexed by their AllBitBoards slot so a board character can be
+// turned into a key with the same bitboardForPiece lookup pushMove already uses.
+// the keys come from a fixed seed so hashes are stable between runs and builds.
+//
+struct ZobristKeys
+{
+    uint64_t pieces[16][64];    // only the 12 piece slots are filled, the aggregates stay zero
+    uint64_t sideToMove;        // xored in when black is to move
+    uint64_t castling[16];      // one key per castling rights combination
+    uint64_t enPassantFile[8];
+
+    constexpr ZobristKeys() : pieces(), sideToMove(0), castling(), enPassantFile()
+    {
+        uint64_t seed = 0x4A6F686E5A6F6272ULL;
+        auto next = [&seed]() {
+            // splitmix64
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+
+        const int pieceSlots[12] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 10, 11, 12 };
+        for (int slot : pieceSlots) {
+            for (int square = 0; square < 64; ++square) {
+                pieces[slot][square] = next();
+            }
+        }
+        sideToMove = next();
+        // castling keys are built from one key per right so that clearing a single
+        // right is the same as xoring out that right's key
+        uint64_t rights[4] = { next(), next(), next(), next() };
+        for (int mask = 0; mask < 16; ++mask) {
+            for (int right = 0; right < 4; ++right) {
+                if (mask & (1 << right)) {
+                    castling[mask] ^= rights[right];
+                }
+            }
+        }
+        for (int file = 0; file < 8; ++file) {
+            enPassantFile[file] = next();
+        }
+    }
+};
+
+inline constexpr ZobristKeys Zobrist;
@@ -12,6 +12,7 @@
 #include <d3d11.h>
 #include <tchar.h>
 #include "Application.h"
+#include "classes/Trace.h"
 
 // Data
 ID3D11Device*            g_pd3dDevice = nullptr;
@@ -106,12 +107,14 @@ int main(int, char**)
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
     // Our state
+    TRACE_THREAD_NAME("main");
     ClassGame::GameStartUp();
 
     // Main loop
     bool done = false;
     while (!done)
     {
+        TRACE_SCOPE("frame");
         // Poll and handle messages (inputs, window resize, etc.)
         // See the WndProc() function below for our to dispatch events to the Win32 backend.
         MSG msg;
@@ -168,6 +171,9 @@ int main(int, char**)
         g_SwapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
     }
 
+    // Chrome trace_event JSON, only when built with CHESS_TRACING
+    TRACE_DUMP("chess_trace.json");
+
     // Cleanup
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdio>
+
+//
+// the pass/fail reporting the tests share: each check prints one line, main returns
+// non-zero when any of them failed
+//
+inline int failures = 0;
+
+inline void check(bool ok, const char* what)
+{
+    std::printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+    if (!ok) {
+        failures++;
+    }
+}
@@ -0,0 +1,73 @@
+//
+// alloc_test: proves the chess search does no heap allocation per node
+//
+// every global operator new is counted, the transposition table and the GameState
+// are set up first and then a fixed depth search must finish with the counter at zero
+//
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "../classes/Search.h"
+
+static std::atomic<long> g_allocations{0};
+static std::atomic<bool> g_counting{false};
+
+void* operator new(std::size_t size)
+{
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main()
+{
+    const char* positions[] = {
+        // start position
+        "RNBQKBNRPPPPPPPP00000000000000000000000000000000pppppppprnbqkbnr",
+        // italian game, both sides developed
+        "R0BQK00RPPPP0PPP00N00N0000B0P0000000p00000n00n00pppp0pppr0bqkb0r",
+    };
+
+    TranspositionTable tt(1);
+    int failures = 0;
+
+    for (const char* position : positions) {
+        GameState gs;
+        gs.init(position, WHITE);
+        Search search(tt);
+
+        g_allocations = 0;
+        g_counting = true;
+        int score = 0;
+        BitMove best = search.searchRoot(gs, 4, &score);
+        g_counting = false;
+
+        long allocations = g_allocations.load();
+        std::printf("best %d-%d score %d: %ld allocations\n", best.from, best.to, score, allocations);
+        if (allocations != 0) {
+            failures++;
+        }
+    }
+
+    if (failures) {
+        std::printf("FAILED: search allocated on the heap\n");
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+//
+// move_ordering_test: capture flags from the generators and the quality of the ordering
+//
+// every generated move is checked for IsCapture against the board it came from, a few
+// plies deep in positions with en passant and promotions. then fixed depth searches
+// report how often the first move tried was the one that cut off.
+//
+#include <cstdio>
+#include "../classes/Search.h"
+
+static const char* Positions[] = {
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+// walks the tree and counts moves whose capture flag disagrees with the board
+static int checkCaptureFlags(GameState& gs, int depth)
+{
+    MoveList moves;
+    gs.generateAllMoves(moves);
+    int errors = 0;
+    for (const BitMove& move : moves) {
+        bool captures = (move.flags & EnPassant) || gs.state[move.to] != '0';
+        if (captures != ((move.flags & IsCapture) != 0)) {
+            std::printf("bad capture flag on %s\n", moveToString(move).c_str());
+            errors++;
+        }
+        if (depth > 1) {
+            gs.pushMove(move);
+            errors += checkCaptureFlags(gs, depth - 1);
+            gs.popState();
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    int failures = 0;
+    TranspositionTable tt(16);
+
+    for (const char* fen : Positions) {
+        GameState gs;
+        gs.initFromFEN(fen);
+        failures += checkCaptureFlags(gs, 3);
+
+        tt.clear();
+        Search search(tt);
+        SearchLimits limits;
+        limits.maxDepth = 5;
+        SearchResult result = search.think(gs, limits);
+        std::printf("%-72s depth %d nodes %8llu first move cutoffs %.1f%%\n", fen, result.depth,
+                    (unsigned long long)result.nodes, 100.0 * result.firstMoveCutoffRate());
+        // in generation order this was 10-50% on these positions
+        if (result.firstMoveCutoffRate() < 0.65) {
+            std::printf("FAILED: move ordering is not finding the cutoff move first\n");
+            failures++;
+        }
+    }
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
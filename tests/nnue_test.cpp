@@ -0,0 +1,181 @@
+//
+// nnue_test: loads a network with random weights and checks that every kernel gives the
+// same evaluation, and that the incrementally updated accumulators match a full refresh
+// along random games
+//
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../classes/Search.h"
+#include "TestCheck.h"
+
+// small weights so the hidden layers see a spread of values rather than all clipped
+static bool writeRandomNetwork(const char* path)
+{
+    std::mt19937 rng(1234);
+    auto fill8 = [&rng](std::vector<int8_t>& out, size_t count, int range) {
+        std::uniform_int_distribution<int> dist(-range, range);
+        out.resize(count);
+        for (auto& value : out) value = (int8_t)dist(rng);
+    };
+    auto fill16 = [&rng](std::vector<int16_t>& out, size_t count, int range) {
+        std::uniform_int_distribution<int> dist(-range, range);
+        out.resize(count);
+        for (auto& value : out) value = (int16_t)dist(rng);
+    };
+    auto fill32 = [&rng](std::vector<int32_t>& out, size_t count, int range) {
+        std::uniform_int_distribution<int> dist(-range, range);
+        out.resize(count);
+        for (auto& value : out) value = dist(rng);
+    };
+
+    nnue::FileHeader header = {};
+    std::memcpy(header.magic, "CHESSNN1", 8);
+    header.inputs = nnue::Inputs;
+    header.l1 = nnue::L1;
+    header.l2 = nnue::L2;
+    header.l3 = nnue::L3;
+
+    std::vector<int16_t> ftBias, ftWeights;
+    std::vector<int32_t> l1Bias, l2Bias, outBias;
+    std::vector<int8_t> l1Weights, l2Weights, outWeights;
+    fill16(ftBias, nnue::L1, 40);
+    fill16(ftWeights, (size_t)nnue::Inputs * nnue::L1, 12);
+    fill32(l1Bias, nnue::L2, 2000);
+    fill8(l1Weights, nnue::L2 * 2 * nnue::L1, 3);
+    fill32(l2Bias, nnue::L3, 2000);
+    fill8(l2Weights, nnue::L3 * nnue::L2, 20);
+    fill32(outBias, 1, 500);
+    fill8(outWeights, nnue::L3, 60);
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fwrite(ftBias.data(), sizeof(int16_t), ftBias.size(), file);
+    std::fwrite(ftWeights.data(), sizeof(int16_t), ftWeights.size(), file);
+    std::fwrite(l1Bias.data(), sizeof(int32_t), l1Bias.size(), file);
+    std::fwrite(l1Weights.data(), sizeof(int8_t), l1Weights.size(), file);
+    std::fwrite(l2Bias.data(), sizeof(int32_t), l2Bias.size(), file);
+    std::fwrite(l2Weights.data(), sizeof(int8_t), l2Weights.size(), file);
+    std::fwrite(outBias.data(), sizeof(int32_t), outBias.size(), file);
+    std::fwrite(outWeights.data(), sizeof(int8_t), outWeights.size(), file);
+    return std::fclose(file) == 0;
+}
+
+int main()
+{
+    const char* path = "nnue_test.nnue";
+    check(writeRandomNetwork(path), "wrote a random network");
+
+    nnue::Network network;
+    check(!network.load("nnue_test_missing.nnue"), "a missing file is rejected");
+    check(network.load(path), "random network loads");
+    if (!network.loaded()) {
+        return 1;
+    }
+    std::printf("kernel: %s\n", nnue::kernelName(network.kernel()));
+
+    const char* positions[] = {
+        StartPositionFEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+
+    // every kernel the cpu runs must give the scalar result exactly
+    const nnue::Kernel kernels[] = { nnue::Kernel::Scalar, nnue::Kernel::Sse41, nnue::Kernel::Avx2 };
+    bool kernelsAgree = true;
+    std::vector<int> scalarScores;
+    for (nnue::Kernel kernel : kernels) {
+        if (!network.setKernel(kernel)) {
+            std::printf("%s not supported here\n", nnue::kernelName(kernel));
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+            GameState gs;
+            gs.initFromFEN(positions[i]);
+            nnue::Evaluator evaluator(network);
+            int score = evaluator.evaluate(gs);
+            if (kernel == nnue::Kernel::Scalar) {
+                scalarScores.push_back(score);
+            } else if (score != scalarScores[i]) {
+                std::printf("%s: %d, scalar %d\n", nnue::kernelName(kernel), score, scalarScores[i]);
+                kernelsAgree = false;
+            }
+        }
+    }
+    check(kernelsAgree, "vector kernels match the scalar kernel");
+    network.setKernel(nnue::Kernel::Auto);
+
+    // random games, stepping back now and then so accumulator slots get reused by other lines
+    std::mt19937 rng(42);
+    int mismatches = 0;
+    int evaluations = 0;
+    for (const char* fen : positions) {
+        GameState gs;
+        gs.initFromFEN(fen);
+        nnue::Evaluator incremental(network);
+        for (int game = 0; game < 20; ++game) {
+            int plies = 0;
+            while (plies < 60) {
+                MoveList moves;
+                gs.generateAllMoves(moves);
+                if (moves.size() == 0) {
+                    break;
+                }
+                gs.pushMove(moves[rng() % moves.size()]);
+                plies++;
+                if (plies > 2 && rng() % 4 == 0) {
+                    gs.popState();
+                    plies--;
+                }
+                // skipped positions make the next update replay several moves
+                if (rng() % 3 == 0) {
+                    continue;
+                }
+
+                nnue::Evaluator fresh(network);
+                int expected = fresh.evaluate(gs);
+                int actual = incremental.evaluate(gs);
+                evaluations++;
+                if (expected != actual) {
+                    mismatches++;
+                }
+            }
+            while (plies-- > 0) {
+                gs.popState();
+            }
+        }
+    }
+    std::printf("%d evaluations, %d mismatches\n", evaluations, mismatches);
+    check(mismatches == 0, "incremental accumulators match a full refresh");
+
+    // a search on the network plays a legal move
+    TranspositionTable tt(4);
+    Search search(tt);
+    search.setNetwork(&network);
+    GameState gs;
+    gs.initFromFEN(positions[1]);
+    SearchLimits limits;
+    limits.maxDepth = 4;
+    SearchResult result = search.think(gs, limits);
+    MoveList legal;
+    gs.generateAllMoves(legal);
+    bool found = false;
+    for (const BitMove& move : legal) {
+        found = found || (move.from == result.bestMove.from && move.to == result.bestMove.to);
+    }
+    std::printf("depth %d: %s score %d, %llu nodes\n", result.depth, moveToString(result.bestMove).c_str(),
+                result.score, (unsigned long long)result.nodes);
+    check(found, "search on the network returns a legal move");
+
+    std::remove(path);
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+//
+// opening_book_test: the entry and key encoding, and the book book_builder made from
+// tests/data/openings.pgn (passed as the only argument)
+//
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../classes/OpeningBook.h"
+#include "TestCheck.h"
+
+static bool play(GameState& gs, const std::vector<std::string>& moves)
+{
+    for (const std::string& text : moves) {
+        MoveList legal;
+        gs.generateAllMoves(legal);
+        bool found = false;
+        for (const BitMove& move : legal) {
+            if (moveToString(move) == text) {
+                gs.pushMove(move);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the book moves of a position as "e2e4:5" strings, in file order
+static std::vector<std::string> bookMoves(const book::OpeningBook& book, GameState& gs)
+{
+    std::vector<std::string> result;
+    size_t first;
+    size_t count = book.find(book::positionKey(gs), first);
+    for (size_t i = first; i < first + count; ++i) {
+        book::Entry entry = book.entry(i);
+        BitMove move = book::decodeMove(gs, entry.move);
+        result.push_back(moveToString(move) + ":" + std::to_string(entry.weight));
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    book::Entry entry;
+    entry.key = 0x0123456789ABCDEFULL;
+    entry.move = 0x1234;
+    entry.weight = 0xBEEF;
+    entry.learn = 0xCAFEF00D;
+    unsigned char bytes[book::EntrySize];
+    book::writeEntry(entry, bytes);
+    book::Entry back = book::readEntry(bytes);
+    check(bytes[0] == 0x01 && bytes[7] == 0xEF && back.key == entry.key && back.move == entry.move &&
+          back.weight == entry.weight && back.learn == entry.learn, "entries are big-endian and round trip");
+
+    GameState white;
+    white.initFromFEN(StartPositionFEN);
+    GameState black;
+    black.initFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1");
+    GameState noCastling;
+    noCastling.initFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w Kkq - 0 1");
+    check(book::positionKey(white) != book::positionKey(black) &&
+          book::positionKey(white) != book::positionKey(noCastling), "side to move and castling change the key");
+
+    // the keys published with the polyglot format, reached by playing the moves
+    check(book::positionKey(white) == 0x463B96181691FC9CULL, "start position has the polyglot key");
+    struct KnownKey { std::vector<std::string> moves; uint64_t key; };
+    const KnownKey knownKeys[] = {
+        { { "e2e4" }, 0x823C9B50FD114196ULL },
+        { { "e2e4", "d7d5" }, 0x0756B94461C50FB0ULL },
+        { { "e2e4", "d7d5", "e4e5" }, 0x662FAFB965DB29D4ULL },
+        { { "e2e4", "d7d5", "e4e5", "f7f5" }, 0x22A48B5A8E47FF78ULL },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2" }, 0x652A607CA3F242C1ULL },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2", "e8f7" }, 0x00FDD303C946BDD9ULL },
+        { { "a2a4", "b7b5", "h2h4", "b5b4", "c2c4" }, 0x3C8123EA7B067637ULL },
+        { { "a2a4", "b7b5", "h2h4", "b5b4", "c2c4", "b4c3", "a1a3" }, 0x5C3F9B829B279560ULL },
+    };
+    bool knownKeysMatch = true;
+    for (const KnownKey& known : knownKeys) {
+        GameState gs;
+        gs.initFromFEN(StartPositionFEN);
+        knownKeysMatch &= play(gs, known.moves) && book::positionKey(gs) == known.key;
+    }
+    check(knownKeysMatch, "published polyglot keys after e2e4 and the en passant/castling lines");
+
+    GameState castles;
+    castles.initFromFEN("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    MoveList moves;
+    castles.generateAllMoves(moves);
+    bool castlingRoundTrip = true;
+    for (const BitMove& move : moves) {
+        castlingRoundTrip = castlingRoundTrip && book::decodeMove(castles, book::encodeMove(move)) == move;
+        if (move.flags & KingSideCastle) {
+            castlingRoundTrip = castlingRoundTrip && book::encodeMove(move) == (7 | (4 << 6));
+        }
+    }
+    check(castlingRoundTrip, "moves round trip, castling is king takes rook");
+
+    if (argc < 2) {
+        std::printf("no book given, skipping the built book checks\n");
+        return failures ? 1 : 0;
+    }
+    book::OpeningBook book;
+    check(book.open(argv[1]), "book opens");
+
+    GameState gs;
+    gs.initFromFEN(StartPositionFEN);
+    std::vector<std::string> start = bookMoves(book, gs);
+    check(start == std::vector<std::string>({ "e2e4:5", "d2d4:1" }), "start position: e4 won twice and drew once, d4 drew once");
+
+    play(gs, { "e2e4" });
+    std::vector<std::string> reply = bookMoves(book, gs);
+    check(reply == std::vector<std::string>({ "c7c5:2", "e7e5:1" }), "lost games give no weight, variations are skipped");
+
+    // 5. O-O in the ruy lopez, and 8. Nbxd2 needing its file
+    GameState ruy;
+    ruy.initFromFEN(StartPositionFEN);
+    play(ruy, { "e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6", "b5a4", "g8f6" });
+    size_t first;
+    bool castled = book.find(book::positionKey(ruy), first) == 1 &&
+                   (book::decodeMove(ruy, book.entry(first).move).flags & KingSideCastle);
+    check(castled, "castling read from SAN and stored as e1h1");
+    GameState italian;
+    italian.initFromFEN(StartPositionFEN);
+    play(italian, { "e2e4", "e7e5", "g1f3", "b8c6", "f1c4", "f8c5", "c2c3", "g8f6", "d2d4", "e5d4",
+                    "c3d4", "c5b4", "c1d2", "b4d2" });
+    check(bookMoves(book, italian) == std::vector<std::string>({ "b1d2:2" }), "disambiguated capture");
+
+    // weighted pick: every random number maps into the range, each move by its weight
+    gs.initFromFEN(StartPositionFEN);
+    int picks[2] = { 0, 0 };
+    for (uint64_t random = 0; random < 600; ++random) {
+        BitMove move;
+        if (book.pickMove(gs, random, move)) {
+            picks[moveToString(move) == "e2e4" ? 0 : 1]++;
+        }
+    }
+    std::printf("picks: e2e4 %d, d2d4 %d\n", picks[0], picks[1]);
+    check(picks[0] == 500 && picks[1] == 100, "moves are picked in proportion to their weight");
+
+    GameState outOfBook;
+    outOfBook.initFromFEN("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    BitMove none;
+    check(!book.pickMove(outOfBook, 0, none), "no move out of book");
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+//
+// pawn_table_test: the pawn zobrist key pushMove keeps against a recompute, the pawn
+// structure terms on hand-made positions, and the table returning what it stored
+//
+#include <cstdio>
+#include <initializer_list>
+#include "../classes/PawnTable.h"
+#include "TestCheck.h"
+
+static int checkPawnHash(GameState& gs, int depth)
+{
+    int errors = (gs.pawnHash != gs.computePawnHash()) ? 1 : 0;
+    if (depth == 0) {
+        return errors;
+    }
+    MoveList moves;
+    gs.generateAllMoves(moves);
+    for (const BitMove& move : moves) {
+        gs.pushMove(move);
+        errors += checkPawnHash(gs, depth - 1);
+        gs.popState();
+    }
+    return errors;
+}
+
+static PawnEntry pawnsOf(const char* fen)
+{
+    GameState gs;
+    gs.initFromFEN(fen);
+    return evaluatePawns(gs._bitboards[WHITE_PAWNS].getData(), gs._bitboards[BLACK_PAWNS].getData());
+}
+
+static uint64_t squares(std::initializer_list<int> list)
+{
+    uint64_t bb = 0;
+    for (int square : list) bb |= 1ULL << square;
+    return bb;
+}
+
+int main()
+{
+    // en passant, promotions with and without capture, pawn captures
+    const char* positions[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+    int hashErrors = 0;
+    for (const char* fen : positions) {
+        GameState gs;
+        gs.initFromFEN(fen);
+        hashErrors += checkPawnHash(gs, 3);
+    }
+    check(hashErrors == 0, "incremental pawn key matches a recompute");
+
+    GameState start;
+    start.initFromFEN(StartPositionFEN);
+    GameState knightsOnly;
+    knightsOnly.initFromFEN("rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1");
+    check(start.pawnHash == knightsOnly.pawnHash && start.hash != knightsOnly.hash,
+          "pieces other than pawns leave the pawn key alone");
+
+    PawnEntry symmetric = pawnsOf(StartPositionFEN);
+    check(symmetric.midgame == 0 && symmetric.endgame == 0 && !symmetric.passed[0] && !symmetric.passed[1],
+          "start position is balanced with no passed pawns");
+
+    // nothing stands in front of any of these, doubled pawns included
+    PawnEntry open = pawnsOf("4k3/7p/P7/8/8/2P5/2P5/4K3 w - - 0 1");
+    check(open.passed[0] == squares({ 40, 18, 10 }) && open.passed[1] == squares({ 55 }), "unopposed pawns are passed");
+
+    // a pawn on an adjacent file in front stops it, one behind doesn't
+    PawnEntry stopped = pawnsOf("4k3/3p4/8/2P5/8/8/1p6/4K3 w - - 0 1");
+    check(!(stopped.passed[0] & squares({ 34 })), "a pawn that can be captured on its way isn't passed");
+    check(stopped.passed[1] & squares({ 9 }), "a pawn behind doesn't stop a passer");
+
+    // mirrored positions score the same for the other side
+    PawnEntry white = pawnsOf("4k3/8/8/8/1P6/8/PP3P2/4K3 w - - 0 1");
+    PawnEntry black = pawnsOf("4k3/pp3p2/8/1p6/8/8/8/4K3 w - - 0 1");
+    check(white.midgame == -black.midgame && white.endgame == -black.endgame, "terms are colour symmetric");
+    PawnEntry doubled = pawnsOf("4k3/8/8/8/P7/P7/8/4K3 w - - 0 1");
+    PawnEntry single = pawnsOf("4k3/8/8/8/P7/8/8/4K3 w - - 0 1");
+    check(doubled.endgame < single.endgame * 2, "a doubled pawn is worth less than two");
+
+    PawnTable table(64);
+    GameState gs;
+    gs.initFromFEN(positions[0]);
+    const PawnEntry& first = table.probe(gs);
+    PawnEntry expected = evaluatePawns(gs._bitboards[WHITE_PAWNS].getData(), gs._bitboards[BLACK_PAWNS].getData());
+    const PawnEntry& second = table.probe(gs);
+    check(first.key == gs.pawnHash && second.midgame == expected.midgame && second.endgame == expected.endgame,
+          "table returns the stored entry");
+    check(table.hits() == 1 && table.misses() == 1, "second probe is a hit");
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
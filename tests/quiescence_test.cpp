@@ -0,0 +1,111 @@
+//
+// quiescence_test: the captures-only generator, static exchange evaluation and the
+// horizon effect the quiescence search is there to remove
+//
+#include <cstdio>
+#include <cstring>
+#include "../classes/Search.h"
+#include "TestCheck.h"
+
+static bool sameMoves(const BitMove& a, const BitMove& b)
+{
+    return a.from == b.from && a.to == b.to && a.flags == b.flags;
+}
+
+// generateCaptures must give exactly the captures and promotions of generateAllMoves,
+// or all of them when in check
+static int checkCaptureGenerator(GameState& gs, int depth)
+{
+    MoveList all;
+    MoveList captures;
+    gs.generateAllMoves(all);
+    gs.generateCaptures(captures);
+    const bool inCheck = gs.inCheck(gs.color);
+
+    int expected = 0;
+    int errors = 0;
+    for (const BitMove& move : all) {
+        if (!inCheck && !(move.flags & (IsCapture | IsPromotion))) {
+            continue;
+        }
+        expected++;
+        bool found = false;
+        for (const BitMove& capture : captures) {
+            found = found || sameMoves(move, capture);
+        }
+        if (!found) {
+            std::printf("missing %s\n", moveToString(move).c_str());
+            errors++;
+        }
+    }
+    if (expected != captures.size()) {
+        errors++;
+    }
+
+    if (depth > 1) {
+        for (const BitMove& move : all) {
+            gs.pushMove(move);
+            errors += checkCaptureGenerator(gs, depth - 1);
+            gs.popState();
+        }
+    }
+    return errors;
+}
+
+static int exchange(const char* fen, const char* uci)
+{
+    GameState gs;
+    gs.initFromFEN(fen);
+    MoveList moves;
+    gs.generateAllMoves(moves);
+    for (const BitMove& move : moves) {
+        if (moveToString(move) == uci) {
+            return staticExchange(gs, move);
+        }
+    }
+    std::printf("no move %s\n", uci);
+    return 0x7FFFFFFF;
+}
+
+int main()
+{
+    const char* positions[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+    int generatorErrors = 0;
+    for (const char* fen : positions) {
+        GameState gs;
+        gs.initFromFEN(fen);
+        generatorErrors += checkCaptureGenerator(gs, 3);
+    }
+    check(generatorErrors == 0, "captures-only generator matches the full generator");
+
+    // undefended pawn
+    check(exchange("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5") == MidgameValue[Pawn], "see wins a loose pawn");
+    // queen takes a pawn the enemy pawn defends
+    check(exchange("4k3/8/3p4/4p3/3Q4/8/8/4K3 w - - 0 1", "d4e5") == MidgameValue[Pawn] - MidgameValue[Queen], "see loses the queen for a pawn");
+    // knight takes a pawn defended twice, the rook behind the knight doesn't save it
+    check(exchange("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5") < 0, "see sees the x-ray defenders");
+    // loose rook, the rook behind adds nothing
+    check(exchange("4k3/8/3r4/8/8/3R4/8/3RK3 w - - 0 1", "d3d6") == MidgameValue[Rook], "see counts a won rook");
+
+    // at depth one a plain search grabs the defended pawn with check, the quiescence
+    // search sees the recapture and takes the free pawn instead
+    TranspositionTable tt(1);
+    Search search(tt);
+    GameState gs;
+    gs.initFromFEN("4k3/8/3p4/4p3/3Q4/8/8/4K3 w - - 0 1");
+    int score = 0;
+    BitMove best = search.searchRoot(gs, 1, &score);
+    std::printf("depth 1: %s score %d\n", moveToString(best).c_str(), score);
+    check(moveToString(best) == "d4d6", "depth one search avoids the poisoned pawn");
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
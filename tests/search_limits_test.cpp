@@ -0,0 +1,54 @@
+//
+// search_limits_test: iterative deepening stops where its limits say
+//
+// a node limited search is run twice on fresh tables and must pick the same move
+// after the same number of nodes. a short movetime must come back on time with a
+// move from a finished iteration, and a depth limit must stop at that depth.
+//
+#include <cstdio>
+#include "../classes/Search.h"
+#include "TestCheck.h"
+
+static const char* Middlegame = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
+
+static SearchResult run(const SearchLimits& limits)
+{
+    GameState gs;
+    gs.initFromFEN(Middlegame);
+    TranspositionTable tt(4);
+    Search search(tt);
+    return search.think(gs, limits);
+}
+
+int main()
+{
+    SearchLimits nodes;
+    nodes.nodes = 50000;
+    SearchResult first = run(nodes);
+    SearchResult second = run(nodes);
+    std::printf("nodes: depth %d move %s score %d nodes %llu\n", first.depth,
+                moveToString(first.bestMove).c_str(), first.score, (unsigned long long)first.nodes);
+    check(first.nodes == nodes.nodes, "node limit is exact");
+    check(first.depth > 0, "node limited search finishes an iteration");
+    check(first.depth == second.depth && first.score == second.score &&
+          first.nodes == second.nodes && first.bestMove.from == second.bestMove.from &&
+          first.bestMove.to == second.bestMove.to, "node limited search is deterministic");
+
+    SearchLimits timed;
+    timed.moveTimeMs = 100;
+    SearchResult quick = run(timed);
+    std::printf("movetime: depth %d move %s %.3f s\n", quick.depth, moveToString(quick.bestMove).c_str(), quick.seconds);
+    check(quick.depth > 0 && quick.bestMove.piece != NoPiece, "timed search returns a finished iteration");
+    check(quick.seconds < 0.3, "timed search stops on time");
+
+    SearchLimits depth;
+    depth.maxDepth = 3;
+    SearchResult fixed = run(depth);
+    check(fixed.depth == 3, "depth limit is respected");
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
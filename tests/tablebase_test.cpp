@@ -0,0 +1,148 @@
+//
+// tablebase_test: builds the three piece tables in memory and checks them against
+// themselves one ply deep with the ordinary move generator, against known endgame
+// results, after a save and load, and inside the search
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "../classes/Search.h"
+#include "../classes/TablebaseGenerator.h"
+#include "TestCheck.h"
+
+static int8_t probeFEN(const tb::Tablebases& tablebases, const char* fen)
+{
+    GameState gs;
+    gs.initFromFEN(fen);
+    int8_t value = tb::Illegal;
+    tablebases.probe(gs, value);
+    return value;
+}
+
+// every legal position's value must follow from its children's: the retrograde pass
+// walks un-moves, this walks the moves GameState generates
+static int checkConsistency(const tb::Tablebases& tablebases, const char* name, int& longest)
+{
+    tb::Signature signature;
+    signature.parse(name);
+    GameState gs;
+    MoveList moves;
+    int errors = 0;
+    longest = 0;
+    for (uint64_t index = 0; index < signature.entries(); ++index) {
+        int squares[tb::MaxPieces];
+        bool whiteToMove;
+        tb::squaresOf(signature, index, squares, whiteToMove);
+        char board[64];
+        std::memset(board, '0', sizeof(board));
+        bool overlap = false;
+        for (int i = 0; i < signature.count; ++i) {
+            overlap = overlap || board[squares[i]] != '0';
+            const int piece = signature.boards[i];
+            board[squares[i]] = (piece < WHITE_ALL_PIECES) ? "PNBRQK"[piece] : "pnbrqk"[piece - BLACK_PAWNS];
+        }
+        if (overlap) {
+            continue;
+        }
+        gs.init(board, whiteToMove ? WHITE : BLACK);
+        gs.castling = 0;
+        int8_t value;
+        if (!tablebases.probe(gs, value)) {
+            continue;
+        }
+        longest = std::max(longest, (int)value);
+
+        gs.generateAllMoves(moves);
+        int8_t expected = tb::Draw;
+        if (moves.empty()) {
+            expected = gs.inCheck(gs.color) ? -1 : tb::Draw;
+        } else {
+            int bestWin = 0;
+            int longestLoss = 0;
+            bool allLose = true;
+            for (const BitMove& move : moves) {
+                gs.pushMove(move);
+                int8_t child = tb::Draw;
+                tablebases.probe(gs, child);
+                gs.popState();
+                if (tb::isLoss(child)) {
+                    const int plies = tb::pliesToMate(child) + 1;
+                    bestWin = bestWin ? std::min(bestWin, plies) : plies;
+                }
+                allLose = allLose && tb::isWin(child);
+                longestLoss = std::max(longestLoss, child + 1);
+            }
+            expected = bestWin ? (int8_t)bestWin : allLose ? (int8_t)(-longestLoss - 1) : tb::Draw;
+        }
+        if (value != expected) {
+            if (errors++ < 5) {
+                std::printf("%s index %llu: %d, moves say %d\n", name, (unsigned long long)index, value, expected);
+            }
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    tb::Tablebases tablebases;
+    check(tb::generate(tablebases, "KPK", 2, true) && tb::generate(tablebases, "KRK", 2, true) &&
+          tb::generate(tablebases, "KQK", 2, true), "generated KPK, KRK, KQK and their dependencies");
+    check(tablebases.has("KQK") && tablebases.has("KBK") && tablebases.has("KNK"), "promotion tables built first");
+
+    tb::Signature flipped;
+    check(flipped.parse("KKR") && flipped.name == "KRK", "names put the stronger side first");
+
+    int longest = 0;
+    int errors = checkConsistency(tablebases, "KPK", longest);
+    check(errors == 0, "KPK agrees with the move generator");
+    errors = checkConsistency(tablebases, "KRK", longest);
+    check(errors == 0, "KRK agrees with the move generator");
+    std::printf("KRK longest mate %d plies\n", longest);
+    check(longest == 31, "KRK longest mate is 16 moves");
+    checkConsistency(tablebases, "KQK", longest);
+    std::printf("KQK longest mate %d plies\n", longest);
+    check(longest == 19, "KQK longest mate is 10 moves");
+
+    // king in front of its pawn on the sixth rank wins whoever moves, a rook pawn
+    // with the defending king in the corner doesn't
+    check(tb::isWin(probeFEN(tablebases, "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1")), "KPK key square win, white to move");
+    check(tb::isLoss(probeFEN(tablebases, "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1")), "KPK key square win, black to move");
+    check(probeFEN(tablebases, "k7/8/K7/P7/8/8/8/8 w - - 0 1") == tb::Draw, "rook pawn draw");
+    check(tb::isLoss(probeFEN(tablebases, "8/8/8/8/4p3/4k3/8/4K3 w - - 0 1")), "colours reversed probe mirrors the board");
+    check(probeFEN(tablebases, "8/8/8/8/8/2k5/8/1K6 w - - 0 1") == tb::Draw, "bare kings draw");
+    check(probeFEN(tablebases, "7k/5Q2/6K1/8/8/8/8/8 w - - 0 1") == 1, "mate in one ply");
+
+    // round trip through a file
+    check(tablebases.save("KRK", "tablebase_test_KRK.tb"), "saved KRK");
+    tb::Tablebases loaded;
+    check(loaded.load("tablebase_test_KRK.tb") && loaded.maxPieces() == 3, "loaded KRK");
+    const char* rookPositions[] = { "8/8/8/4k3/8/8/8/R3K3 w - - 0 1", "8/8/8/4k3/8/8/8/R3K3 b - - 0 1",
+                                    "1k6/8/1K6/8/8/8/8/7R w - - 0 1", "8/8/8/8/8/2k5/8/1K5r w - - 0 1" };
+    bool same = true;
+    for (const char* fen : rookPositions) {
+        same = same && probeFEN(tablebases, fen) == probeFEN(loaded, fen) && probeFEN(loaded, fen) != tb::Illegal;
+    }
+    check(same, "mapped file probes like the table in memory");
+    std::remove("tablebase_test_KRK.tb");
+
+    // the search takes the distance straight from the tables
+    TranspositionTable tt(1);
+    Search search(tt);
+    search.setTablebases(&tablebases);
+    GameState gs;
+    gs.initFromFEN(rookPositions[0]);
+    SearchLimits limits;
+    limits.maxDepth = 2;
+    SearchResult result = search.think(gs, limits);
+    const int8_t rootValue = probeFEN(tablebases, rookPositions[0]);
+    std::printf("search: %s score %d, tables say mate in %d plies, %llu hits\n", moveToString(result.bestMove).c_str(),
+                result.score, rootValue, (unsigned long long)result.tablebaseHits);
+    check(result.score == MATE_SCORE - rootValue && result.tablebaseHits > 0, "search scores the exact mate distance");
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,67 @@
+//
+// trace_test: events from several threads land in the dump as Chrome trace_event JSON,
+// a full ring keeps only its newest events, and finished threads hand their buffer on
+//
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "../classes/Trace.h"
+#include "TestCheck.h"
+
+static int countOf(const std::string& text, const std::string& what)
+{
+    int count = 0;
+    for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+int main()
+{
+    TRACE_THREAD_NAME("main");
+    // overfills the main thread's ring, the four events after it push out four more
+    for (uint64_t i = 0; i < trace::BufferCapacity + 100; ++i) {
+        TRACE_SCOPE("spin");
+    }
+    {
+        TRACE_SCOPE("outer");
+        for (int depth = 1; depth <= 3; ++depth) {
+            TRACE_SCOPE_ARG("iteration", "depth", depth);
+        }
+    }
+
+    // one after the other, so every worker after the first reuses the same buffer
+    for (int i = 0; i < 3; ++i) {
+        std::thread worker([]() {
+            TRACE_THREAD_NAME("worker");
+            TRACE_SCOPE("work");
+        });
+        worker.join();
+    }
+
+    check(TRACE_DUMP("trace_test.json"), "dump written");
+    std::ifstream file("trace_test.json");
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string json = buffer.str();
+    std::remove("trace_test.json");
+
+    check(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0 && json.find("\n]}\n") != std::string::npos,
+          "trace_event object with an event array");
+    check(countOf(json, "\"name\":\"outer\",\"ph\":\"X\"") == 1, "scope recorded as a complete event");
+    check(countOf(json, "\"args\":{\"depth\":") == 3 && json.find("\"args\":{\"depth\":3}") != std::string::npos,
+          "argument recorded");
+    check(countOf(json, "\"name\":\"work\"") == 3, "events from every worker thread");
+    check(countOf(json, "\"args\":{\"name\":\"worker\"}") == 1, "finished threads hand their buffer on");
+    check(countOf(json, "\"args\":{\"name\":\"main\"}") == 1, "thread names written as metadata");
+    check(countOf(json, "\"name\":\"spin\"") == (int)trace::BufferCapacity - 4, "a full ring keeps its newest events");
+
+    if (failures) {
+        return 1;
+    }
+    std::printf("passed\n");
+    return 0;
+}
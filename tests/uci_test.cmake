@@ -0,0 +1,58 @@
+#
+# uci_test: feeds chess-uci short sessions on stdin and checks what it answers.
+# run by ctest as: cmake -DENGINE=<path to chess-uci> -P uci_test.cmake
+#
+function(uci_session name input)
+    file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/uci_${name}.in "${input}")
+    execute_process(COMMAND ${ENGINE}
+                    INPUT_FILE ${CMAKE_CURRENT_BINARY_DIR}/uci_${name}.in
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE result
+                    TIMEOUT 60)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${name}: chess-uci exited with ${result}\n${output}")
+    endif()
+    message(STATUS "${name}:\n${output}")
+    set(output "${output}" PARENT_SCOPE)
+endfunction()
+
+function(expect name pattern)
+    if(NOT output MATCHES "${pattern}")
+        message(FATAL_ERROR "${name}: expected '${pattern}'")
+    endif()
+endfunction()
+
+uci_session(handshake "uci\nsetoption name Hash value 8\nsetoption name Threads value 2\nisready\nquit\n")
+# nothing but protocol on stdout, the first line is the engine's id
+expect(handshake "^id name [^\n]+\n")
+expect(handshake "option name Hash type spin")
+expect(handshake "uciok\n")
+expect(handshake "readyok\n")
+
+uci_session(depth "position startpos moves e2e4 e7e5 g1f3\ngo depth 4\n")
+expect(depth "info depth 4 ")
+expect(depth "bestmove [a-h][1-8][a-h][1-8]\n")
+
+uci_session(mate "position fen 7k/5Q2/6K1/8/8/8/8/8 w - - 0 1\ngo depth 3\n")
+expect(mate "score mate 1 ")
+expect(mate "bestmove f7(g7|f8)\n")
+
+uci_session(promotion "position fen 8/P7/8/8/8/8/k7/4K3 w - - 0 1 moves a7a8q a2b2\ngo nodes 2000\n")
+expect(promotion "bestmove [a-h][1-8][a-h][1-8]\n")
+
+uci_session(movetime "position startpos\ngo movetime 200\n")
+expect(movetime "bestmove [a-h][1-8][a-h][1-8]\n")
+
+uci_session(clock "position startpos moves d2d4\ngo wtime 1000 btime 1000 winc 10 binc 10\n")
+expect(clock "bestmove [a-h][1-8][a-h][1-8]\n")
+
+# stop straight after go must not be lost
+uci_session(infinite "position startpos\ngo infinite\nstop\nisready\n")
+expect(infinite "bestmove [a-h][1-8][a-h][1-8]\n")
+expect(infinite "readyok\n")
+
+# a fen that isn't a legal position is refused, the engine keeps going from startpos
+uci_session(badfen "position fen 4k3/8/8/8/8/8/8/8 w - - 0 1\ngo depth 3\nisready\n")
+expect(badfen "info string bad fen")
+expect(badfen "bestmove [a-h][1-8][a-h][1-8]\n")
+expect(badfen "readyok\n")
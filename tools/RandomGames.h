@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../classes/GameState.h"
+
+//
+// the corpus the benches share: every position of seeded random games from the start,
+// so each run and each bench sees the same positions
+//
+inline uint64_t nextRandom(uint64_t& state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+// onMove sees the game after each move, before the position is kept
+template <typename OnMove>
+std::vector<GameStateData> randomGamePositions(int count, OnMove onMove)
+{
+    // random games, every position along the way is kept
+    std::vector<GameStateData> positions;
+    positions.reserve(count);
+    auto gs = std::make_unique<GameState>();
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    while ((int)positions.size() < count) {
+        gs->initFromFEN(StartPositionFEN);
+        for (int ply = 0; ply < 120 && (int)positions.size() < count; ++ply) {
+            MoveList moves;
+            gs->generateAllMoves(moves);
+            if (moves.empty()) {
+                break;
+            }
+            gs->pushMove(moves[(int)(nextRandom(seed) % moves.size())]);
+            onMove(*gs);
+            positions.push_back(*gs);
+        }
+    }
+    return positions;
+}
+
+inline std::vector<GameStateData> randomGamePositions(int count)
+{
+    return randomGamePositions(count, [](const GameState&) {});
+}
@@ -0,0 +1,322 @@
+//
+// book_builder: makes an opening book from PGN files
+//
+// usage: book_builder <out.bin> <pgn>... [--plies N] [--min-games N]
+//
+// every move of the first --plies plies (20 by default) of every game is counted for
+// the position it was played in. like polyglot's own builder a move scores 2 for each
+// game its side won and 1 for each draw; moves that never scored, or were played in
+// fewer than --min-games games, are left out. weights are scaled to fit 16 bits.
+//
+// games are read from standard PGN: tag pairs, SAN moves with move numbers, comments,
+// variations and NAGs. a game with a move that doesn't parse is used up to that move.
+//
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../classes/OpeningBook.h"
+
+struct MoveStats
+{
+    uint32_t points = 0;
+    uint32_t games = 0;
+};
+
+static ChessPiece pieceOf(char letter)
+{
+    const char* at = letter ? std::strchr(" PNBRQK", letter) : nullptr;
+    return at ? (ChessPiece)(at - " PNBRQK") : NoPiece;
+}
+
+// the legal move a SAN token names, a default BitMove if none or more than one does
+static BitMove parseSan(GameState& gs, std::string san)
+{
+    while (!san.empty() && std::strchr("+#!?", san.back())) {
+        san.pop_back();
+    }
+    MoveList moves;
+    gs.generateAllMoves(moves);
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        const int flag = (san.size() == 3) ? KingSideCastle : QueenSideCastle;
+        for (const BitMove& move : moves) {
+            if (move.flags & flag) {
+                return move;
+            }
+        }
+        return BitMove();
+    }
+
+    ChessPiece promotion = NoPiece;
+    const size_t equals = san.find('=');
+    if (equals != std::string::npos && equals + 1 < san.size()) {
+        promotion = pieceOf(san[equals + 1]);
+        san.erase(equals);
+    } else if (san.size() > 2 && std::strchr("NBRQ", san.back()) && std::isdigit((unsigned char)san[san.size() - 2])) {
+        promotion = pieceOf(san.back());
+        san.pop_back();
+    }
+    if (san.size() < 2) {
+        return BitMove();
+    }
+
+    ChessPiece piece = Pawn;
+    size_t start = 0;
+    if (std::strchr("NBRQK", san[0])) {
+        piece = pieceOf(san[0]);
+        start = 1;
+    }
+    const char toFile = san[san.size() - 2];
+    const char toRank = san[san.size() - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') {
+        return BitMove();
+    }
+    const int to = (toRank - '1') * 8 + (toFile - 'a');
+    int fromFile = -1;
+    int fromRank = -1;
+    for (size_t i = start; i + 2 < san.size(); ++i) {
+        if (san[i] >= 'a' && san[i] <= 'h') fromFile = san[i] - 'a';
+        if (san[i] >= '1' && san[i] <= '8') fromRank = san[i] - '1';
+    }
+
+    BitMove found;
+    int matches = 0;
+    for (const BitMove& move : moves) {
+        if (move.piece != piece || move.to != to || move.promotionPiece() != promotion) continue;
+        if (fromFile >= 0 && move.from % 8 != fromFile) continue;
+        if (fromRank >= 0 && move.from / 8 != fromRank) continue;
+        found = move;
+        matches++;
+    }
+    return matches == 1 ? found : BitMove();
+}
+
+class PgnReader
+{
+public:
+    PgnReader(std::map<std::pair<uint64_t, uint16_t>, MoveStats>& stats, int maxPlies)
+        : _stats(stats), _maxPlies(maxPlies) { }
+
+    void read(const std::string& text)
+    {
+        size_t i = 0;
+        while (i < text.size()) {
+            const char c = text[i];
+            if (c == '[') {
+                size_t end = text.find(']', i);
+                if (_inMoves) {
+                    finishGame("*");
+                }
+                tag(text.substr(i + 1, end == std::string::npos ? std::string::npos : end - i - 1));
+                i = (end == std::string::npos) ? text.size() : end + 1;
+            } else if (c == '{') {
+                size_t end = text.find('}', i);
+                i = (end == std::string::npos) ? text.size() : end + 1;
+            } else if (c == ';') {
+                size_t end = text.find('\n', i);
+                i = (end == std::string::npos) ? text.size() : end + 1;
+            } else if (c == '(') {
+                // variations nest, skip to the matching bracket
+                int depth = 0;
+                for (; i < text.size(); ++i) {
+                    if (text[i] == '(') depth++;
+                    if (text[i] == ')' && --depth == 0) break;
+                }
+                i++;
+            } else if (std::isspace((unsigned char)c)) {
+                i++;
+            } else {
+                size_t end = i;
+                while (end < text.size() && !std::isspace((unsigned char)text[end]) && !std::strchr("{(;[", text[end])) {
+                    end++;
+                }
+                token(text.substr(i, end - i));
+                i = end;
+            }
+        }
+        if (_inMoves) {
+            finishGame("*");
+        }
+    }
+
+    int games() const { return _games; }
+
+private:
+    void tag(const std::string& text)
+    {
+        std::istringstream fields(text);
+        std::string name, value;
+        fields >> name;
+        std::getline(fields, value);
+        const size_t open = value.find('"');
+        const size_t close = value.rfind('"');
+        if (name == "Result" && open != std::string::npos && close > open) {
+            _result = value.substr(open + 1, close - open - 1);
+        }
+    }
+
+    void token(std::string text)
+    {
+        if (text == "1-0" || text == "0-1" || text == "1/2-1/2" || text == "*") {
+            finishGame(text);
+            return;
+        }
+        if (text[0] == '$') {
+            return;
+        }
+        // move numbers, "12." and "12..." alone or glued to the move
+        size_t skip = 0;
+        while (skip < text.size() && (std::isdigit((unsigned char)text[skip]) || text[skip] == '.')) {
+            skip++;
+        }
+        if (skip > 0 && (skip == text.size() || text[skip - 1] == '.')) {
+            text = text.substr(skip);
+        }
+        if (text.empty()) {
+            return;
+        }
+
+        if (!_inMoves) {
+            _inMoves = true;
+            _broken = false;
+            _played.clear();
+            _gs.initFromFEN(StartPositionFEN);
+        }
+        if (_broken || (int)_played.size() >= _maxPlies) {
+            return;
+        }
+        BitMove move = parseSan(_gs, text);
+        if (move.piece == NoPiece) {
+            _broken = true;
+            return;
+        }
+        _played.push_back({ book::positionKey(_gs), book::encodeMove(move), _gs.color });
+        _gs.pushMove(move);
+    }
+
+    void finishGame(const std::string& terminator)
+    {
+        const std::string result = (terminator != "*") ? terminator : _result;
+        for (const Played& played : _played) {
+            MoveStats& entry = _stats[{ played.key, played.move }];
+            entry.games++;
+            if (result == "1/2-1/2") {
+                entry.points += 1;
+            } else if ((result == "1-0" && played.color == WHITE) || (result == "0-1" && played.color == BLACK)) {
+                entry.points += 2;
+            }
+        }
+        if (_inMoves) {
+            _games++;
+        }
+        _inMoves = false;
+        _played.clear();
+        _result.assign(1, '*');
+    }
+
+    struct Played
+    {
+        uint64_t key;
+        uint16_t move;
+        char color;
+    };
+
+    std::map<std::pair<uint64_t, uint16_t>, MoveStats>& _stats;
+    int _maxPlies;
+    GameState _gs;
+    std::vector<Played> _played;
+    std::string _result = "*";
+    bool _inMoves = false;
+    bool _broken = false;
+    int _games = 0;
+};
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: book_builder <out.bin> <pgn>... [--plies N] [--min-games N]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+    const std::string output = argv[1];
+    std::vector<std::string> inputs;
+    int maxPlies = 20;
+    uint32_t minGames = 1;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--plies") && i + 1 < argc) {
+            maxPlies = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--min-games") && i + 1 < argc) {
+            minGames = (uint32_t)std::atoi(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            inputs.push_back(argv[i]);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    std::map<std::pair<uint64_t, uint16_t>, MoveStats> stats;
+    PgnReader reader(stats, maxPlies);
+    for (const std::string& path : inputs) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "can't read %s\n", path.c_str());
+            return 1;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        reader.read(text.str());
+    }
+
+    std::vector<book::Entry> entries;
+    uint32_t maxPoints = 1;
+    for (const auto& item : stats) {
+        if (item.second.points > 0 && item.second.games >= minGames) {
+            maxPoints = std::max(maxPoints, item.second.points);
+        }
+    }
+    for (const auto& item : stats) {
+        if (item.second.points == 0 || item.second.games < minGames) {
+            continue;
+        }
+        book::Entry entry;
+        entry.key = item.first.first;
+        entry.move = item.first.second;
+        uint64_t weight = item.second.points;
+        if (maxPoints > 0xFFFF) {
+            weight = std::max<uint64_t>(1, weight * 0xFFFF / maxPoints);
+        }
+        entry.weight = (uint16_t)weight;
+        entries.push_back(entry);
+    }
+    // sorted by key for the binary search, best move first within a position
+    std::sort(entries.begin(), entries.end(), [](const book::Entry& a, const book::Entry& b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+    std::vector<unsigned char> bytes(entries.size() * book::EntrySize);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        book::writeEntry(entries[i], bytes.data() + i * book::EntrySize);
+    }
+    std::ofstream out(output, std::ios::binary);
+    out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    if (!out) {
+        std::fprintf(stderr, "can't write %s\n", output.c_str());
+        return 1;
+    }
+
+    std::printf("%d games, %zu moves seen, %zu entries written to %s\n", reader.games(), stats.size(),
+                entries.size(), output.c_str());
+    return 0;
+}
@@ -0,0 +1,97 @@
+//
+// eval_bench: evaluations per second, the old std::map board walk against the
+// piece-square tables computed from scratch and read incrementally from GameState
+//
+// usage: eval_bench [--positions N] [--rounds N]
+//
+// the positions come from seeded random games. while playing them the incremental
+// sums are checked against a full recompute after every move, a mismatch fails.
+//
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include "../classes/Search.h"
+#include "RandomGames.h"
+
+// the evaluation before the piece-square tables, kept here as the baseline
+static std::map<char, int> evaluateScores = {
+    {'P',  100}, {'p', -100}, // Pawns
+    {'N',  200}, {'n', -200}, // Knights
+    {'B',  230}, {'b', -230}, // Bishops
+    {'R',  400}, {'r', -400}, // Rooks
+    {'Q',  900}, {'q', -900}, // Queens
+    {'K', 2000}, {'k',-2000}, // Kings
+    {'0',    0}               // Empty square
+};
+
+static int evaluateBoard(const char st[64]) {
+    int s = 0;
+    for (int i = 0; i < 64; ++i) s += evaluateScores[st[i]];
+    return s;
+}
+
+static int evaluateFromScratch(const GameStateData& position)
+{
+    PsqScore score;
+    for (int i = 0; i < 64; i++) {
+        if (position.state[i] != '0') {
+            score.add(bitboardForPiece[(unsigned char)position.state[i]], i);
+        }
+    }
+    return score.tapered() * position.color;
+}
+
+template <typename Eval>
+static void run(const char* name, const std::vector<GameStateData>& positions, int rounds, Eval eval)
+{
+    auto start = std::chrono::steady_clock::now();
+    int64_t checksum = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (const GameStateData& position : positions) {
+            checksum += eval(position);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double evals = (double)positions.size() * rounds;
+    std::printf("%-12s %14.0f %16.0f   (checksum %lld)\n", name, evals, seconds > 0 ? evals / seconds : 0.0,
+                (long long)checksum);
+}
+
+int main(int argc, char** argv)
+{
+    int positionCount = 20000;
+    int rounds = 50;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--positions") && i + 1 < argc) {
+            positionCount = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--rounds") && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: eval_bench [--positions N] [--rounds N]\n");
+            return 2;
+        }
+    }
+
+    int mismatches = 0;
+    std::vector<GameStateData> positions = randomGamePositions(positionCount, [&](const GameState& gs) {
+        PsqScore full = gs.computePsq();
+        if (full.midgame != gs.psq.midgame || full.endgame != gs.psq.endgame || full.phase != gs.psq.phase) {
+            mismatches++;
+        }
+    });
+
+    std::printf("%-12s %14s %16s\n", "eval", "evaluations", "evals/sec");
+    run("std::map", positions, rounds, [](const GameStateData& p) { return evaluateBoard(p.state) * p.color; });
+    run("pst full", positions, rounds, evaluateFromScratch);
+    run("pst incr", positions, rounds, [](const GameStateData& p) { return p.psq.tapered() * p.color; });
+
+    if (mismatches) {
+        std::printf("FAILED: %d positions where the incremental score differs from a recompute\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,251 @@
+//
+// movegen_bench: time per call of each move generation primitive, so a drop in search
+// speed can be pinned on one function
+//
+// usage: movegen_bench [--positions N] [--rounds N] [--json file]
+//
+// the corpus is every position of seeded random games, like eval_bench. each primitive
+// gets one timed pass over the whole corpus, running --rounds times on every position,
+// so a 10ns call isn't drowned by reading the clock. the same pass with nothing but the
+// position loading is timed too and taken off. prints a table, and with --json writes
+// the same numbers as
+//   { "positions": N, "rounds": N, "primitives": [ { "name", "calls", "ns_per_call" }, ... ] }
+//
+// the generator is legal by construction and has no filterOutIllegalMoves pass any more.
+// its legality work is updateCheckInfo (checkers and pins, once per generateAllMoves)
+// and the king's isSquareAttacked tests, so those two are timed in its place.
+//
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../classes/GameState.h"
+#include "RandomGames.h"
+
+struct Timing
+{
+    const char* name;
+    uint64_t calls = 0;
+    double seconds = 0;
+    uint64_t checksum = 0;
+
+    double nsPerCall() const { return calls ? seconds * 1e9 / calls : 0.0; }
+};
+
+class MoveGenBench
+{
+public:
+    MoveGenBench(const std::vector<GameStateData>& positions, int rounds) : _positions(positions), _rounds(rounds)
+    {
+        // the legal moves of every position, made and taken back by the PushPop pass
+        _moveStart.push_back(0);
+        for (size_t i = 0; i < _positions.size(); ++i) {
+            load(i);
+            MoveList moves;
+            _gs->generateAllMoves(moves);
+            _moves.insert(_moves.end(), moves.begin(), moves.end());
+            _moveStart.push_back(_moves.size());
+        }
+    }
+
+    // one timed pass over the corpus per primitive
+    void run()
+    {
+        GameState& gs = *_gs;
+        MoveList moves;
+
+        // loading a position, taken off every pass so only the primitive is counted
+        const double loading = pass(nullptr, [](size_t) { return (size_t)0; }, []() { return (size_t)0; });
+
+        pass(&timings[Pawns], one, [&]() {
+            moves.clear();
+            gs.generatePawnMoveList(moves, gs._bitboards[WHITE_PAWNS + _us], ~_occupancy, _enemies, gs.color, ~0ULL);
+            return moves.size();
+        });
+        pass(&timings[Knights], one, [&]() {
+            moves.clear();
+            gs.generateKnightMoves(moves, gs._bitboards[WHITE_KNIGHTS + _us] & ~gs._pinned, _targets);
+            return moves.size();
+        });
+        pass(&timings[Bishops], one, [&]() {
+            moves.clear();
+            gs.generateBishopMoves(moves, gs._bitboards[WHITE_BISHOPS + _us], _occupancy, _targets);
+            return moves.size();
+        });
+        pass(&timings[Rooks], one, [&]() {
+            moves.clear();
+            gs.generateRooksMoves(moves, gs._bitboards[WHITE_ROOKS + _us], _occupancy, _targets);
+            return moves.size();
+        });
+        pass(&timings[Queens], one, [&]() {
+            moves.clear();
+            gs.generateQueensMoves(moves, gs._bitboards[WHITE_QUEENS + _us], _occupancy, _targets);
+            return moves.size();
+        });
+        pass(&timings[Kings], one, [&]() {
+            moves.clear();
+            gs.generateKingMoves(moves, gs._bitboards[WHITE_KING + _us], _targets);
+            return moves.size();
+        });
+        pass(&timings[Attacked], [](size_t) { return (size_t)64; }, [&]() {
+            size_t attacked = 0;
+            for (int square = 0; square < 64; ++square) {
+                attacked += gs.isSquareAttacked(square, _enemy, _occupancy);
+            }
+            return attacked;
+        });
+        pass(&timings[CheckInfo], one, [&]() {
+            gs.updateCheckInfo();
+            return (size_t)(gs._checkers ^ gs._pinned);
+        });
+        pass(&timings[AllMoves], one, [&]() {
+            gs.generateAllMoves(moves);
+            return moves.size();
+        });
+        // every legal move made and taken back
+        pass(&timings[PushPop], [&](size_t i) { return _moveStart[i + 1] - _moveStart[i]; }, [&]() {
+            size_t hash = 0;
+            for (size_t m = _moveStart[_current]; m < _moveStart[_current + 1]; ++m) {
+                gs.pushMove(_moves[m]);
+                hash += gs.hash;
+                gs.popState();
+            }
+            return hash;
+        });
+
+        for (Timing& timing : timings) {
+            timing.seconds = timing.seconds > loading ? timing.seconds - loading : 0.0;
+        }
+    }
+
+    enum Primitive { Pawns, Knights, Bishops, Rooks, Queens, Kings, Attacked, CheckInfo, AllMoves, PushPop, PrimitiveCount };
+
+    Timing timings[PrimitiveCount] = {
+        { "generatePawnMoveList" }, { "generateKnightMoves" }, { "generateBishopMoves" },
+        { "generateRooksMoves" },   { "generateQueensMoves" }, { "generateKingMoves" },
+        { "isSquareAttacked" },     { "updateCheckInfo" },     { "generateAllMoves" },
+        { "pushMove+popState" },
+    };
+
+private:
+    static size_t one(size_t) { return 1; }
+
+    void load(size_t i)
+    {
+        GameState& gs = *_gs;
+        static_cast<GameStateData&>(gs) = _positions[i];
+        gs.stackPtr = 0;
+        gs.updateCheckInfo();
+        _current = i;
+        _us = (gs.color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+        const int them = (gs.color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS;
+        _enemy = (gs.color == WHITE) ? BLACK : WHITE;
+        _occupancy = gs._bitboards[OCCUPANCY].getData();
+        _targets = ~gs._bitboards[WHITE_ALL_PIECES + _us].getData();
+        _enemies = gs._bitboards[WHITE_ALL_PIECES + them].getData();
+    }
+
+    // body runs --rounds times on each position under one clock for the whole corpus,
+    // so the timer's own cost is spread over every call. calls(i) is how many primitive
+    // calls one run of body makes on position i. returns the seconds taken
+    template <typename Calls, typename Body>
+    double pass(Timing* timing, Calls calls, Body body)
+    {
+        uint64_t checksum = 0;
+        uint64_t callCount = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < _positions.size(); ++i) {
+            load(i);
+            for (int round = 0; round < _rounds; ++round) {
+                checksum += body();
+            }
+            callCount += (uint64_t)_rounds * calls(i);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (timing) {
+            timing->seconds = seconds;
+            timing->calls = callCount;
+            timing->checksum = checksum;
+        }
+        return seconds;
+    }
+
+    const std::vector<GameStateData>& _positions;
+    int _rounds;
+    std::unique_ptr<GameState> _gs = std::make_unique<GameState>();
+    std::vector<BitMove> _moves;
+    std::vector<size_t> _moveStart;
+
+    // the loaded position
+    size_t _current = 0;
+    int _us = WHITE_PAWNS;
+    char _enemy = BLACK;
+    uint64_t _occupancy = 0;
+    uint64_t _targets = 0;
+    uint64_t _enemies = 0;
+};
+
+static bool writeJson(const std::string& path, const MoveGenBench& bench, size_t positions, int rounds)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "{\n  \"positions\": %zu,\n  \"rounds\": %d,\n  \"primitives\": [\n", positions, rounds);
+    for (int i = 0; i < MoveGenBench::PrimitiveCount; ++i) {
+        const Timing& timing = bench.timings[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"calls\": %llu, \"ns_per_call\": %.3f }%s\n", timing.name,
+                     (unsigned long long)timing.calls, timing.nsPerCall(), i + 1 < MoveGenBench::PrimitiveCount ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    int positionCount = 4000;
+    int rounds = 20;
+    std::string jsonPath;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--positions") && i + 1 < argc) {
+            positionCount = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--rounds") && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--json") && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: movegen_bench [--positions N] [--rounds N] [--json file]\n");
+            return 2;
+        }
+    }
+    if (positionCount < 1 || rounds < 1) {
+        std::fprintf(stderr, "usage: movegen_bench [--positions N] [--rounds N] [--json file]\n");
+        return 2;
+    }
+
+    std::vector<GameStateData> positions = randomGamePositions(positionCount);
+
+    MoveGenBench bench(positions, rounds);
+    bench.run();
+
+    std::printf("%zu positions, %d rounds each\n", positions.size(), rounds);
+    std::printf("%-22s %14s %10s %12s\n", "primitive", "calls", "ns/call", "Mcalls/sec");
+    for (const Timing& timing : bench.timings) {
+        std::printf("%-22s %14llu %10.2f %12.2f   (checksum %llu)\n", timing.name, (unsigned long long)timing.calls,
+                    timing.nsPerCall(), timing.seconds > 0 ? timing.calls / timing.seconds / 1e6 : 0.0,
+                    (unsigned long long)timing.checksum);
+    }
+
+    if (!jsonPath.empty()) {
+        if (!writeJson(jsonPath, bench, positions.size(), rounds)) {
+            std::fprintf(stderr, "can't write %s\n", jsonPath.c_str());
+            return 1;
+        }
+        std::printf("wrote %s\n", jsonPath.c_str());
+    }
+    return 0;
+}
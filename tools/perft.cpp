@@ -0,0 +1,209 @@
+//
+// perft: counts the leaf nodes of the legal move tree to check and time move generation
+//
+// usage: perft <fen|startpos> <depth> [--hash MB] [--threads N] [--split plies] [--expect nodes]
+//
+// prints the node count below every root move (divide), then the total and nodes/sec.
+// with --expect the exit code is non-zero when the total doesn't match, which is
+// what the ctest suite uses.
+//
+// with --threads the tree is cut --split plies below the root (1 by default) and every
+// subtree there becomes a task on a work-stealing pool, each with its own GameState.
+// the hash table, if any, is shared by all of them.
+//
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../classes/GameState.h"
+#include "../classes/ThreadPool.h"
+
+//
+// optional transposition table for perft, keyed on hash and depth.
+// entries are xor-verified like the search table so they are safe to share.
+//
+class PerftTable
+{
+public:
+    PerftTable(size_t sizeMB)
+    {
+        size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= (sizeMB << 20)) {
+            count *= 2;
+        }
+        _entries.reset(new Entry[count]);
+        _mask = count - 1;
+        for (size_t i = 0; i < count; ++i) {
+            _entries[i].key.store(0, std::memory_order_relaxed);
+            _entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool probe(uint64_t hash, int depth, uint64_t& nodes) const
+    {
+        const Entry& entry = _entries[hash & _mask];
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if ((entry.key.load(std::memory_order_relaxed) ^ data) != hash || (int)(data & 0xFF) != depth) {
+            return false;
+        }
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t hash, int depth, uint64_t nodes)
+    {
+        Entry& entry = _entries[hash & _mask];
+        uint64_t data = (nodes << 8) | (uint64_t)depth;
+        entry.key.store(hash ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+    std::unique_ptr<Entry[]> _entries;
+    size_t _mask;
+};
+
+static uint64_t perft(GameState& gs, int depth, PerftTable* table)
+{
+    MoveList moves;
+    gs.generateAllMoves(moves);
+    // bulk counting, the legal move count is the leaf count one ply down
+    if (depth <= 1) {
+        return depth == 1 ? (uint64_t)moves.size() : 1;
+    }
+
+    uint64_t nodes = 0;
+    if (table && table->probe(gs.hash, depth, nodes)) {
+        return nodes;
+    }
+    for (const BitMove& move : moves) {
+        gs.pushMove(move);
+        nodes += perft(gs, depth - 1, table);
+        gs.popState();
+    }
+    if (table) {
+        table->store(gs.hash, depth, nodes);
+    }
+    return nodes;
+}
+
+// walks the first splitPlies of the tree and queues every position there as a task.
+// each task copies the GameState so the workers never share one.
+static void queueSubtrees(ThreadPool& pool, GameState& gs, int depth, int splitPlies, PerftTable* table,
+                          std::atomic<uint64_t>& rootCount)
+{
+    if (splitPlies == 0 || depth <= 1) {
+        auto task = std::make_shared<GameState>(gs);
+        pool.submit([task, depth, table, &rootCount]() {
+            rootCount += perft(*task, depth, table);
+        });
+        return;
+    }
+
+    MoveList moves;
+    gs.generateAllMoves(moves);
+    for (const BitMove& move : moves) {
+        gs.pushMove(move);
+        queueSubtrees(pool, gs, depth - 1, splitPlies - 1, table, rootCount);
+        gs.popState();
+    }
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: perft <fen|startpos> <depth> [--hash MB] [--threads N] [--split plies] [--expect nodes]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+
+    std::string fen = argv[1];
+    if (fen == "startpos") {
+        fen = StartPositionFEN;
+    }
+    int depth = std::atoi(argv[2]);
+    size_t hashMB = 0;
+    long long expected = -1;
+    int threads = 1;
+    int splitPlies = 1;
+    for (int i = 3; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--hash") && i + 1 < argc) {
+            hashMB = (size_t)std::atoll(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--split") && i + 1 < argc) {
+            splitPlies = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--expect") && i + 1 < argc) {
+            expected = std::atoll(argv[++i]);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    GameState gs;
+    if (depth < 1 || threads < 1 || splitPlies < 1 || !gs.initFromFEN(fen)) {
+        usage();
+        return 2;
+    }
+    std::unique_ptr<PerftTable> table;
+    if (hashMB > 0) {
+        table = std::make_unique<PerftTable>(hashMB);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    MoveList rootMoves;
+    gs.generateAllMoves(rootMoves);
+    uint64_t total = 0;
+    if (threads == 1) {
+        for (const BitMove& move : rootMoves) {
+            gs.pushMove(move);
+            uint64_t nodes = perft(gs, depth - 1, table.get());
+            gs.popState();
+            total += nodes;
+            std::printf("%s: %llu\n", moveToString(move).c_str(), (unsigned long long)nodes);
+        }
+    } else {
+        std::vector<std::atomic<uint64_t>> rootCounts(rootMoves.size());
+        {
+            ThreadPool pool(threads);
+            for (int i = 0; i < rootMoves.size(); ++i) {
+                rootCounts[i] = 0;
+                gs.pushMove(rootMoves[i]);
+                queueSubtrees(pool, gs, depth - 1, splitPlies - 1, table.get(), rootCounts[i]);
+                gs.popState();
+            }
+            pool.wait();
+        }
+        for (int i = 0; i < rootMoves.size(); ++i) {
+            total += rootCounts[i];
+            std::printf("%s: %llu\n", moveToString(rootMoves[i]).c_str(), (unsigned long long)rootCounts[i].load());
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("\nNodes searched: %llu\n", (unsigned long long)total);
+    std::printf("Time: %.3f s\n", seconds);
+    std::printf("Nodes/sec: %.0f\n", seconds > 0 ? total / seconds : 0.0);
+
+    if (expected >= 0 && (uint64_t)expected != total) {
+        std::printf("FAILED: expected %lld nodes\n", expected);
+        return 1;
+    }
+    return 0;
+}
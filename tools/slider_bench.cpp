@@ -0,0 +1,63 @@
+//
+// slider_bench: compares rook/bishop attack lookups per second for each slider backend
+//
+// usage: slider_bench [iterations]
+//
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../classes/MagicBitboards.h"
+
+static uint64_t nextRandom(uint64_t& state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 200;
+    if (iterations <= 0) {
+        iterations = 200;
+    }
+
+    // sparse random occupancies, roughly the density of a middlegame board
+    std::vector<uint64_t> occupancies(4096);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (auto& occ : occupancies) {
+        occ = nextRandom(seed) & nextRandom(seed);
+    }
+
+    const SliderBackend backends[] = { SliderBackend::Magic, SliderBackend::Pext };
+
+    std::printf("%-8s %14s %14s\n", "backend", "lookups", "Mlookups/sec");
+    for (SliderBackend backend : backends) {
+        if (!sliderBackendSupported(backend)) {
+            std::printf("%-8s %14s %14s\n", sliderBackendName(backend), "-", "unsupported");
+            continue;
+        }
+        initMagicBitboards(backend);
+
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            for (uint64_t occ : occupancies) {
+                for (int square = 0; square < 64; ++square) {
+                    checksum += getRookAttacks(square, occ);
+                    checksum += getBishopAttacks(square, occ);
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double lookups = double(iterations) * double(occupancies.size()) * 64.0 * 2.0;
+        std::printf("%-8s %14.0f %14.1f   (checksum %016llx)\n", sliderBackendName(backend), lookups,
+                    lookups / seconds / 1e6, (unsigned long long)checksum);
+    }
+    return 0;
+}
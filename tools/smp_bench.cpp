@@ -0,0 +1,90 @@
+//
+// smp_bench: lazy SMP speedup, time for every position to reach a fixed depth
+//
+// usage: smp_bench [--depth D] [--threads 1,2,4,8,16] [--hash MB]
+//
+// each thread count starts from a cleared table. prints the total time to depth,
+// nodes/sec and the speedup over the first thread count in the list. the exit code
+// is non-zero if any search fails to return a move at the requested depth.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../classes/SmpSearch.h"
+
+static const char* Positions[] = {
+    StartPositionFEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: smp_bench [--depth D] [--threads 1,2,4,8,16] [--hash MB]\n");
+}
+
+int main(int argc, char** argv)
+{
+    int depth = 6;
+    size_t hashMB = 64;
+    std::vector<int> threadCounts = { 1, 2, 4, 8, 16 };
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--depth") && i + 1 < argc) {
+            depth = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--hash") && i + 1 < argc) {
+            hashMB = (size_t)std::atoll(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threadCounts.clear();
+            for (char* token = std::strtok(argv[++i], ","); token; token = std::strtok(nullptr, ",")) {
+                threadCounts.push_back(std::atoi(token));
+            }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (depth < 1 || threadCounts.empty()) {
+        usage();
+        return 2;
+    }
+
+    TranspositionTable tt(hashMB);
+    SmpSearch search(tt);
+    SearchLimits limits;
+    limits.maxDepth = depth;
+
+    int failures = 0;
+    double baseSeconds = 0;
+    std::printf("depth %d, %d positions\n", depth, (int)(sizeof(Positions) / sizeof(Positions[0])));
+    std::printf("%8s %12s %14s %12s %8s\n", "threads", "seconds", "nodes", "nodes/sec", "speedup");
+    for (int threads : threadCounts) {
+        search.setThreadCount(threads);
+        double seconds = 0;
+        uint64_t nodes = 0;
+        for (const char* fen : Positions) {
+            GameState gs;
+            gs.initFromFEN(fen);
+            tt.clear();
+            auto start = std::chrono::steady_clock::now();
+            SearchResult result = search.think(gs, limits);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            nodes += result.nodes;
+            if (result.depth != depth || result.bestMove.piece == NoPiece) {
+                std::printf("FAILED: %s reached depth %d\n", fen, result.depth);
+                failures++;
+            }
+        }
+        if (baseSeconds == 0) {
+            baseSeconds = seconds;
+        }
+        std::printf("%8d %12.3f %14llu %12.0f %7.2fx\n", threads, seconds, (unsigned long long)nodes,
+                    seconds > 0 ? nodes / seconds : 0.0, seconds > 0 ? baseSeconds / seconds : 0.0);
+    }
+    return failures ? 1 : 0;
+}
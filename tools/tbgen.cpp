@@ -0,0 +1,73 @@
+//
+// tbgen: builds endgame tablebases by retrograde analysis
+//
+// usage: tbgen <table>... [--out dir] [--threads N]
+//
+// tables are named by material, stronger side first: KQK, KRK, KPK, KRKP, KBNK.
+// everything a named table captures or promotes into is built first and written too,
+// one dir/NAME.tb per table. up to four pieces, kings included. nothing is downloaded.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../classes/TablebaseGenerator.h"
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: tbgen <table>... [--out dir] [--threads N]\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> names;
+    std::string directory = ".";
+    int threads = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--out") && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (argv[i][0] == 'K') {
+            names.push_back(argv[i]);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (names.empty()) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    tb::Tablebases tablebases;
+    for (const std::string& name : names) {
+        tb::Signature signature;
+        if (!signature.parse(name)) {
+            std::fprintf(stderr, "%s: not a table of two kings and at most %d pieces\n", name.c_str(), tb::MaxPieces);
+            return 2;
+        }
+        if (!tb::generate(tablebases, name, threads, true)) {
+            return 1;
+        }
+    }
+
+    for (const std::string& name : tablebases.names()) {
+        const std::string path = directory + "/" + name + ".tb";
+        if (!tablebases.save(name, path)) {
+            std::fprintf(stderr, "can't write %s\n", path.c_str());
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%d tables written to %s in %.2f s on %d threads\n", (int)tablebases.names().size(),
+                directory.c_str(), seconds, threads);
+    return 0;
+}
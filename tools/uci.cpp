@@ -0,0 +1,365 @@
+//
+// chess-uci: the engine without the board, speaking UCI on stdin/stdout
+//
+// supported: uci, isready, ucinewgame, setoption (Hash, Threads),
+// position startpos|fen ... [moves ...], go (depth, nodes, movetime, wtime/btime,
+// winc/binc, movestogo, infinite), stop, quit
+//
+// chess-uci bench [depth], or bench [depth] as a command: searches the positions below
+// to a fixed depth (BenchDepth by default) on one thread with a fresh 16 MB table and
+// prints the total nodes, time and nodes/sec. the node count only changes when the
+// search does, so it is quoted in commits as the build's signature.
+//
+// the search runs on its own thread so stop and isready are answered while it thinks.
+// output from both threads goes through say(), one whole line at a time.
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "../classes/SmpSearch.h"
+
+static constexpr int MaxHashMB = 4096;
+static constexpr int MaxThreads = 256;
+
+static constexpr int BenchDepth = 7;
+
+// middlegames, endgames, mates and stalemates. changing this list changes the signature
+static const char* BenchPositions[] = {
+    StartPositionFEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkb1r/pp3ppp/2np1n2/4p1B1/3NP3/2N5/PPP2PPP/R2QKB1R w KQkq e6 0 7",
+    "r1bq1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9",
+    "2r1nrk1/p2q1ppp/bp1p4/n1pPp3/P1P1P3/2PBB1N1/4QPPP/R4RK1 w - - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+    "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+    "8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+    "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
+    "8/8/8/8/4k3/8/4P3/4K3 w - - 0 1",
+    "8/8/8/2k5/8/8/8/3RR1K1 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+    "5rk1/5ppp/8/8/8/8/5PPP/R5K1 b - - 0 1",
+};
+
+static std::mutex outputMutex;
+
+static void say(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::fputs(line.c_str(), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+}
+
+// "cp 35" or "mate 3", mate in moves rather than plies, negative when getting mated
+static std::string scoreToString(int score)
+{
+    if (score > MATE_BOUND) {
+        return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+    }
+    if (score < -MATE_BOUND) {
+        return "mate -" + std::to_string((MATE_SCORE + score) / 2);
+    }
+    return "cp " + std::to_string(score);
+}
+
+class UciEngine
+{
+public:
+    UciEngine() : _search(_tt, 1)
+    {
+        _position.initFromFEN(StartPositionFEN);
+        _search.setIterationCallback([](const SearchResult& result) {
+            const uint64_t nps = result.seconds > 0 ? (uint64_t)(result.nodes / result.seconds) : 0;
+            say("info depth " + std::to_string(result.depth) + " seldepth " + std::to_string(result.selDepth) +
+                " score " + scoreToString(result.score) + " nodes " + std::to_string(result.nodes) +
+                " nps " + std::to_string(nps) + " time " + std::to_string((int)(result.seconds * 1000)) +
+                " pv " + moveToString(result.bestMove));
+        });
+    }
+
+    ~UciEngine() { stop(); }
+
+    // end of input: a search with limits is left to finish and print its move,
+    // "go infinite" is stopped
+    void finish()
+    {
+        if (_infinite) {
+            stop();
+        } else if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+    // false on quit
+    bool command(const std::string& line)
+    {
+        std::istringstream tokens(line);
+        std::string name;
+        tokens >> name;
+        if (name == "uci") {
+            say("id name Chess");
+            say("id author the Chess authors");
+            say("option name Hash type spin default " + std::to_string(TranspositionTable::DefaultSizeMB) +
+                " min 1 max " + std::to_string(MaxHashMB));
+            say("option name Threads type spin default 1 min 1 max " + std::to_string(MaxThreads));
+            say("uciok");
+        } else if (name == "isready") {
+            say("readyok");
+        } else if (name == "ucinewgame") {
+            stop();
+            _tt.clear();
+            _position.initFromFEN(StartPositionFEN);
+        } else if (name == "setoption") {
+            stop();
+            setOption(tokens);
+        } else if (name == "position") {
+            stop();
+            setPosition(tokens);
+        } else if (name == "go") {
+            stop();
+            go(tokens);
+        } else if (name == "stop") {
+            stop();
+        } else if (name == "bench") {
+            stop();
+            int depth = BenchDepth;
+            tokens >> depth;
+            bench(depth);
+        } else if (name == "quit") {
+            return false;
+        } else if (!name.empty()) {
+            say("info string unknown command " + name);
+        }
+        return true;
+    }
+
+    // one thread and its own table, so the node count doesn't depend on the options set
+    static uint64_t bench(int depth)
+    {
+        TranspositionTable tt(16);
+        Search search(tt);
+        SearchLimits limits;
+        limits.maxDepth = std::max(1, depth);
+        const int count = (int)(sizeof(BenchPositions) / sizeof(BenchPositions[0]));
+        uint64_t nodes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            GameState gs;
+            gs.initFromFEN(BenchPositions[i]);
+            tt.newSearch();
+            SearchResult result = search.think(gs, limits);
+            nodes += result.nodes;
+            std::fprintf(stderr, "position %d/%d: %s %llu nodes\n", i + 1, count, moveToString(result.bestMove).c_str(),
+                         (unsigned long long)result.nodes);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        say("===========================");
+        say("Total time (ms) : " + std::to_string((long long)(seconds * 1000)));
+        say("Nodes searched  : " + std::to_string(nodes));
+        say("Nodes/second    : " + std::to_string(seconds > 0 ? (uint64_t)(nodes / seconds) : 0));
+        return nodes;
+    }
+
+private:
+    void setOption(std::istringstream& tokens)
+    {
+        // setoption name <id> value <x>, the id may have spaces in it
+        std::string token, id, value;
+        tokens >> token;
+        while (tokens >> token && token != "value") {
+            id += (id.empty() ? "" : " ") + token;
+        }
+        tokens >> value;
+        if (id == "Hash") {
+            _tt.resize((size_t)std::clamp(std::atoi(value.c_str()), 1, MaxHashMB));
+        } else if (id == "Threads") {
+            _search.setThreadCount(std::clamp(std::atoi(value.c_str()), 1, MaxThreads));
+        } else {
+            say("info string unknown option " + id);
+        }
+    }
+
+    void setPosition(std::istringstream& tokens)
+    {
+        std::string token;
+        tokens >> token;
+        std::string fen = StartPositionFEN;
+        if (token == "fen") {
+            fen.clear();
+            while (tokens >> token && token != "moves") {
+                fen += (fen.empty() ? "" : " ") + token;
+            }
+        } else {
+            tokens >> token;
+        }
+        if (!_position.initFromFEN(fen)) {
+            say("info string bad fen " + fen);
+            _position.initFromFEN(StartPositionFEN);
+            return;
+        }
+        if (token != "moves") {
+            return;
+        }
+        while (tokens >> token) {
+            if (!playMove(token)) {
+                say("info string illegal move " + token);
+                return;
+            }
+        }
+    }
+
+    bool playMove(const std::string& text)
+    {
+        MoveList moves;
+        _position.generateAllMoves(moves);
+        for (const BitMove& move : moves) {
+            if (moveToString(move) == text) {
+                _position.pushMove(move);
+                // the game is never taken back, so the undo stack is dropped after
+                // every move and a long game can't run out of it
+                _position.stackPtr = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void go(std::istringstream& tokens)
+    {
+        SearchLimits limits;
+        bool infinite = false;
+        std::string token;
+        long long value;
+        while (tokens >> token) {
+            if (token == "infinite") {
+                infinite = true;
+                continue;
+            }
+            if (token == "searchmoves" || token == "ponder") {
+                continue;
+            }
+            if (!(tokens >> value)) {
+                break;
+            }
+            const bool white = _position.color == WHITE;
+            if (token == "depth") {
+                limits.maxDepth = (int)value;
+            } else if (token == "nodes") {
+                limits.nodes = (uint64_t)value;
+            } else if (token == "movetime") {
+                limits.moveTimeMs = (int)value;
+            } else if (token == (white ? "wtime" : "btime")) {
+                limits.timeLeftMs = (int)std::max(1LL, value);
+            } else if (token == (white ? "winc" : "binc")) {
+                limits.incrementMs = (int)value;
+            } else if (token == "movestogo") {
+                limits.movesToGo = (int)value;
+            }
+        }
+
+        _stopRequested = false;
+        _finished = false;
+        _infinite = infinite;
+        _tt.newSearch();
+        _thread = std::thread([this, limits, infinite]() {
+            SearchResult result = _search.think(_position, limits);
+            // "go infinite" only answers once it is told to stop, even with nothing left to search
+            if (infinite) {
+                std::unique_lock<std::mutex> lock(_stopMutex);
+                _stopCondition.wait(lock, [this]() { return _stopRequested; });
+            }
+            _finished = true;
+            if (result.bestMove.piece == NoPiece) {
+                say("bestmove 0000");
+            } else {
+                say("bestmove " + moveToString(result.bestMove));
+            }
+        });
+    }
+
+    // ends the running search, if any, after it has printed its bestmove
+    void stop()
+    {
+        if (!_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_stopMutex);
+            _stopRequested = true;
+        }
+        _stopCondition.notify_all();
+        // think() clears the stop flag when it starts, so a stop sent straight after go
+        // could be lost. keep asking until the search has returned
+        while (!_finished) {
+            _search.stop();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        _thread.join();
+    }
+
+    TranspositionTable _tt;
+    SmpSearch _search;
+    GameState _position;
+    std::thread _thread;
+    std::mutex _stopMutex;
+    std::condition_variable _stopCondition;
+    bool _stopRequested = false;
+    std::atomic<bool> _finished{true};
+    bool _infinite = false;
+};
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && !std::strcmp(argv[1], "bench")) {
+        UciEngine::bench(argc > 2 ? std::atoi(argv[2]) : BenchDepth);
+        return 0;
+    }
+    UciEngine engine;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!engine.command(line)) {
+            return 0;
+        }
+    }
+    engine.finish();
+    return 0;
+}